@@ -0,0 +1,301 @@
+#!/usr/bin/env python3
+"""
+End-to-end pipeline benchmark
+Runs the full pipeline on fixed corpora (synthetic projects against the stub
+model, plus any real project replayed from a recorded cassette), records
+throughput, compile and wall-time KPIs, and fails when they regress past a
+threshold against the baseline or when a run crashes
+"""
+
+import argparse
+import json
+import logging
+import resource
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+from dataclasses import dataclass, replace
+from pathlib import Path
+from typing import Any, Dict, List, Optional
+
+BENCH_DIR = Path(__file__).resolve().parent
+REPO_DIR = BENCH_DIR.parent
+sys.path.insert(0, str(REPO_DIR / "src"))
+
+from synthetic_project import ProjectShape, generate_project  # noqa: E402
+from stub_llm_server import StubSettings, start_stub  # noqa: E402
+from test_generator import CppTestGenerator, GeneratorConfig  # noqa: E402
+
+BASELINE = BENCH_DIR / "baseline.json"
+
+
+@dataclass
+class Corpus:
+    project: Optional[str] = None  # existing project, answered from `cassette`
+    cassette: Optional[str] = None
+    files: int = 0  # synthetic project size, answered by the stub model
+    broken_rate: float = 0.0
+    workers: int = 0  # worker processes; their outputs must still link into one test binary
+
+
+# Real projects are added with --recorded once a cassette has been recorded against a model
+CORPORA = {
+    "synthetic-small": Corpus(files=60, broken_rate=0.1),
+    "synthetic-medium": Corpus(files=240, broken_rate=0.05),
+    "synthetic-small-workers": Corpus(files=60, broken_rate=0.1, workers=4),
+}
+
+
+def add_recorded(entries: List[str]) -> List[str]:
+    """Register NAME=PROJECT,CASSETTE corpora; returns their names"""
+    names = []
+    for entry in entries:
+        name, _, paths = entry.partition('=')
+        project, _, cassette = paths.partition(',')
+        if not (name and project and cassette):
+            raise ValueError(f"expected NAME=PROJECT,CASSETTE, got {entry!r}")
+        CORPORA[name] = Corpus(project=str(Path(project).resolve()), cassette=str(Path(cassette).resolve()))
+        names.append(name)
+    return names
+
+# KPI -> whether higher is better
+KPIS = {
+    "files_per_min": True,
+    "tokens_per_s": True,
+    "first_pass_compile_rate": True,
+    "time_to_green_s": False,
+    "build_wall_s": False,
+    "test_wall_s": False,
+    "peak_rss_mb": False,
+}
+
+# Absolute differences below these never count as regressions (sub-second test runs jitter by 100%)
+NOISE_FLOOR = {"time_to_green_s": 1.0, "build_wall_s": 1.0, "test_wall_s": 0.5, "peak_rss_mb": 5.0}
+
+
+def instrument(generator: CppTestGenerator, start: float) -> Dict[str, Any]:
+    """Time builds and test runs, note whether the last build succeeded and when the tests first pass,
+    and keep the first-pass test files"""
+    state: Dict[str, Any] = {"build_wall_s": 0.0, "test_wall_s": 0.0, "green_at": None, "built": None,
+                             "first_pass": {}}
+
+    def timed(name: str, key: str, on_result=None):
+        method = getattr(generator, name)
+
+        def wrapper(*args, **kwargs):
+            began = time.perf_counter()
+            result = method(*args, **kwargs)
+            state[key] += time.perf_counter() - began
+            if on_result:
+                on_result(result)
+            return result
+        setattr(generator, name, wrapper)
+
+    def green(passed: bool):
+        if passed and state["green_at"] is None:
+            state["green_at"] = time.perf_counter() - start
+
+    timed("build_tests", "build_wall_s", lambda result: state.update(built=result[0]))
+    timed("run_coverage_analysis", "test_wall_s", lambda info: green(bool(info and info.get("test_success"))))
+    timed("run_tests", "test_wall_s", lambda result: green(result[0]))
+
+    generate = generator.generate_initial_tests
+
+    def snapshot(*args, **kwargs):
+        ok = generate(*args, **kwargs)
+        state["first_pass"] = {path.name: generator.read_file_content(path)
+                               for path in generator.output_dir.glob("test_*.cpp")}
+        return ok
+    generator.generate_initial_tests = snapshot
+    return state
+
+
+def run_corpus(name: str, work: Path, args: argparse.Namespace) -> Dict[str, Any]:
+    """One pipeline run; called in a child process so peak RSS belongs to this corpus alone"""
+    corpus = CORPORA[name]
+    output = work / name / "output"
+    shutil.rmtree(output, ignore_errors=True)
+    server = None
+
+    if corpus.files:
+        project = work / name / "project"
+        if not project.is_dir():
+            generate_project(project, ProjectShape.for_files(corpus.files))
+        server, _ = start_stub(StubSettings(latency=args.stub_latency, broken_rate=corpus.broken_rate))
+        config = GeneratorConfig(project_path=str(project), output_dir=str(output), model_provider='ollama',
+                                 model_name='stub', api_url=server.url, stage_routing=False, jobs=args.jobs,
+                                 workers=corpus.workers)
+    else:
+        for required in (corpus.project, corpus.cassette):
+            if not Path(required).exists():
+                return {"skipped": f"{required} not found"}
+        config = GeneratorConfig(project_path=corpus.project, output_dir=str(output), model_provider='ollama',
+                                 model_name=args.model, replay=corpus.cassette, replay_speed=args.replay_speed,
+                                 jobs=args.jobs)
+
+    generator = CppTestGenerator(config)
+    sources = len(generator.find_cpp_files())
+    start = time.perf_counter()
+    state = instrument(generator, start)
+    completed = generator.run_full_pipeline()
+    wall = time.perf_counter() - start
+    
+    # Resuming a finished run must not ask the model anything again
+    resumed = CppTestGenerator(replace(config, resume=True))
+    resumed.run_full_pipeline()
+    resume_calls = sum(stats["calls"] for stats in resumed.metrics.to_dict()["stages"].values())
+    if server is not None:
+        server.shutdown()
+
+    # Screen the first-pass files outside the timed run
+    checker = generator._syntax_checker()
+    first_pass = state["first_pass"]
+    compiled = sum(checker.check(content).ok for content in first_pass.values())
+
+    stages = generator.metrics.to_dict()["stages"].values()
+    tokens = sum(stats["prompt_tokens"] + stats["completion_tokens"] for stats in stages)
+    return {
+        "completed": completed,
+        "built": state["built"],
+        "sources": sources,
+        "tests": len(first_pass),
+        "wall_s": round(wall, 2),
+        "files_per_min": round(sources / wall * 60, 1),
+        "tokens_per_s": round(tokens / wall, 1),
+        "first_pass_compile_rate": round(compiled / len(first_pass), 3) if first_pass else None,
+        "time_to_green_s": None if state["green_at"] is None else round(state["green_at"], 2),
+        "build_wall_s": round(state["build_wall_s"], 2),
+        "test_wall_s": round(state["test_wall_s"], 2),
+        "peak_rss_mb": round(resource.getrusage(resource.RUSAGE_SELF).ru_maxrss / 1024, 1),
+        "peak_child_rss_mb": round(resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss / 1024, 1),
+        "resume_calls": resume_calls,
+    }
+
+
+def compare(results: Dict[str, Dict[str, Any]], baseline: Dict[str, Dict[str, Any]],
+            threshold: float) -> tuple[List[str], List[str]]:
+    """Markdown rows for every KPI and the list of regressions beyond threshold (a share, 0.15 = 15%)"""
+    rows, regressions = [], []
+    for corpus, current in results.items():
+        before = baseline.get(corpus)
+        if "skipped" in current:
+            rows.append(f"| {corpus} | — | — | — | — | skipped: {current['skipped']} |")
+            continue
+        if "failed" in current or not current.get("completed"):
+            reason = current.get("failed", "pipeline did not complete")
+            regressions.append(f"{corpus}: {reason}")
+            rows.append(f"| {corpus} | — | — | — | — | FAILED: {reason} |")
+            continue
+        if current.get("built") is False:
+            regressions.append(f"{corpus}: the generated tests did not build")
+            rows.append(f"| {corpus} | built | true | false | — | REGRESSED |")
+        if current.get("resume_calls"):
+            regressions.append(f"{corpus} resume_calls: {current['resume_calls']} (must be 0)")
+            rows.append(f"| {corpus} | resume_calls | 0 | {current['resume_calls']} | — | REGRESSED |")
+        for kpi, higher_is_better in KPIS.items():
+            now, was = current.get(kpi), (before or {}).get(kpi)
+            status, change = "new", "—"
+            if was is not None and now is None:
+                status = "REGRESSED (no value)"
+            elif was is not None and now is not None:
+                delta = (now - was) / was if was else 0.0
+                change = f"{delta:+.1%}"
+                worse = -delta if higher_is_better else delta
+                if abs(now - was) < NOISE_FLOOR.get(kpi, 0.0):
+                    worse = 0.0
+                status = "REGRESSED" if worse > threshold else ("improved" if worse < -threshold else "ok")
+            if status.startswith("REGRESSED"):
+                regressions.append(f"{corpus} {kpi}: {was} -> {now}")
+            rows.append(f"| {corpus} | {kpi} | {'—' if was is None else was} | "
+                        f"{'—' if now is None else now} | {change} | {status} |")
+    return rows, regressions
+
+
+def run_child(name: str, work: Path, args: argparse.Namespace) -> Dict[str, Any]:
+    """Run one corpus in a child process; a crash is a failure, only missing inputs are skipped"""
+    command = [sys.executable, str(Path(__file__).resolve()), "--run-one", name, "--work-dir", str(work),
+               "--jobs", str(args.jobs), "--stub-latency", str(args.stub_latency),
+               "--replay-speed", str(args.replay_speed), "--model", args.model]
+    for entry in args.recorded or []:
+        command += ["--recorded", entry]
+    result = subprocess.run(command, capture_output=True, text=True, cwd=work)
+    last_error = (result.stderr.strip().splitlines() or [f"exit status {result.returncode}"])[-1]
+    if result.returncode != 0 or not result.stdout.strip():
+        return {"failed": f"run crashed: {last_error}"}
+    try:
+        return json.loads(result.stdout.strip().splitlines()[-1])
+    except ValueError:
+        return {"failed": f"unreadable result: {last_error}"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Run the pipeline on fixed corpora and compare KPIs to a baseline")
+    parser.add_argument("--corpus", action="append",
+                        help=f"Corpus to run (repeatable; default all): {', '.join(CORPORA)} or a --recorded name")
+    parser.add_argument("--baseline", default=str(BASELINE), help="Baseline KPIs to compare against")
+    parser.add_argument("--threshold", type=float, default=0.15,
+                        help="Fail when a KPI is worse than the baseline by more than this share")
+    parser.add_argument("--update-baseline", action="store_true", help="Store these results as the new baseline")
+    parser.add_argument("--output", help="Write the measured KPIs here as JSON")
+    parser.add_argument("--work-dir", help="Keep projects and outputs here instead of a temporary directory")
+    parser.add_argument("--jobs", type=int, default=4, help="Concurrent generation requests")
+    parser.add_argument("--stub-latency", type=float, default=0.05, help="Stub model seconds per answer")
+    parser.add_argument("--replay-speed", type=float, default=1.0, help="Cassette replay speed; 0 is instant")
+    parser.add_argument("--recorded", action="append", metavar="NAME=PROJECT,CASSETTE",
+                        help="Also run a real project replayed from a cassette recorded with "
+                             "'test_generator.py --record' (repeatable)")
+    parser.add_argument("--model", default='llama3.2:latest', help="Model the --recorded cassettes were recorded with")
+    parser.add_argument("--run-one", help=argparse.SUPPRESS)
+    args = parser.parse_args()
+    try:
+        add_recorded(args.recorded or [])
+    except ValueError as e:
+        parser.error(str(e))
+    unknown = [name for name in args.corpus or [] if name not in CORPORA]
+    if unknown:
+        parser.error(f"unknown corpus: {', '.join(unknown)}")
+
+    work = Path(args.work_dir) if args.work_dir else Path(tempfile.mkdtemp(prefix="pipeline_bench_"))
+    work.mkdir(parents=True, exist_ok=True)
+    if args.run_one:
+        logging.getLogger().setLevel(logging.WARNING)
+        print(json.dumps(run_corpus(args.run_one, work, args)))
+        return
+
+    results: Dict[str, Dict[str, Any]] = {}
+    try:
+        for name in args.corpus or list(CORPORA):
+            print(f"Running {name}...", file=sys.stderr)
+            results[name] = run_child(name, work, args)
+    finally:
+        if not args.work_dir:
+            shutil.rmtree(work, ignore_errors=True)
+
+    baseline_path = Path(args.baseline)
+    baseline = json.loads(baseline_path.read_text(encoding='utf-8')) if baseline_path.is_file() else {}
+    rows, regressions = compare(results, baseline, args.threshold)
+    print("| Corpus | KPI | Baseline | Current | Change | Status |")
+    print("|--------|-----|----------|---------|--------|--------|")
+    print("\n".join(rows))
+    if args.output:
+        Path(args.output).write_text(json.dumps(results, indent=2), encoding='utf-8')
+
+    if args.update_baseline:
+        failed = [name for name, kpis in results.items() if "failed" in kpis or not kpis.get("completed", True)]
+        if failed:
+            print(f"\nNot updating the baseline: {', '.join(failed)} failed", file=sys.stderr)
+            sys.exit(1)
+        measured = {name: kpis for name, kpis in results.items() if "skipped" not in kpis}
+        baseline_path.write_text(json.dumps(dict(baseline, **measured), indent=2) + "\n", encoding='utf-8')
+        print(f"\nBaseline updated: {baseline_path}")
+    elif regressions:
+        print(f"\n{len(regressions)} KPI regression(s) beyond {args.threshold:.0%}:", file=sys.stderr)
+        for regression in regressions:
+            print(f"  {regression}", file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""
+Pipeline scaling benchmark
+Runs discovery, test generation, build generation and coverage on synthetic
+projects of growing size against the stub model server, and writes a markdown
+report with per-stage times, per-file costs and the scaling exponent between sizes
+"""
+
+import argparse
+import json
+import logging
+import math
+import shutil
+import sys
+import tempfile
+import time
+from pathlib import Path
+from typing import Any, Dict, List, Optional
+
+sys.path.insert(0, str(Path(__file__).resolve().parent.parent / "src"))
+
+from synthetic_project import ProjectShape, generate_project  # noqa: E402
+from stub_llm_server import StubSettings, start_stub  # noqa: E402
+from test_generator import CppTestGenerator, GeneratorConfig  # noqa: E402
+
+STAGES = ["discovery", "generation", "build_generation", "build", "coverage"]
+
+
+def timed(results: Dict[str, Any], stage: str, fn):
+    start = time.perf_counter()
+    value = fn()
+    results[stage] = round(time.perf_counter() - start, 3)
+    return value
+
+
+def run_size(files: int, work: Path, stub_url: str, args: argparse.Namespace) -> Dict[str, Any]:
+    shape = ProjectShape.for_files(files, include_depth=args.include_depth, lines=args.lines)
+    project = work / f"project_{files}"
+    if not project.is_dir():
+        generate_project(project, shape)
+    output = work / f"output_{files}"
+    shutil.rmtree(output, ignore_errors=True)
+
+    generator = CppTestGenerator(GeneratorConfig(
+        project_path=str(project), output_dir=str(output), model_provider='ollama', model_name='stub',
+        api_url=stub_url, jobs=args.jobs, stage_routing=False, gate_retries=0))
+    results: Dict[str, Any] = {"files": shape.files}
+
+    sources = timed(results, "discovery", generator.find_cpp_files)
+    results["sources"] = len(sources)
+    timed(results, "generation", generator.generate_initial_tests)
+    tests = sorted(output.glob("test_*.cpp"))
+    results["tests"] = len(tests)
+    timed(results, "build_generation", generator._generate_cmake_for_tests)
+
+    if len(tests) <= args.max_build_files:
+        built, _ = timed(results, "build", generator.build_tests)
+        results["built"] = built
+        if built:
+            coverage = timed(results, "coverage", generator.run_coverage_analysis)
+            results["tests_passed"] = bool(coverage.get("test_success"))
+    stages = generator.metrics.to_dict()["stages"].values()
+    results["llm_calls"] = sum(stats["calls"] for stats in stages)
+    results["prompt_tokens"] = sum(stats["prompt_tokens"] for stats in stages)
+    return results
+
+
+def exponent(small: Dict[str, Any], large: Dict[str, Any], stage: str) -> Optional[float]:
+    """Slope of log(time) over log(files): 1.0 is linear, above 1 grows faster than the project"""
+    if not small.get(stage) or not large.get(stage) or large["files"] == small["files"]:
+        return None
+    return math.log(large[stage] / small[stage]) / math.log(large["files"] / small["files"])
+
+
+def render_report(rows: List[Dict[str, Any]], args: argparse.Namespace) -> str:
+    def cell(row, stage):
+        return f"{row[stage]:.2f}" if stage in row else "—"
+
+    lines = ["# Pipeline scaling", "",
+             f"Synthetic Drogon-style projects (include depth {args.include_depth}, ~{args.lines} lines per file), "
+             f"stub model with {args.latency}s latency, {args.jobs} concurrent requests. Build and coverage "
+             f"run up to {args.max_build_files} test files.", "",
+             "## Wall time (s)", "",
+             "| Files | Tests | " + " | ".join(STAGES) + " |",
+             "|" + "---|" * (len(STAGES) + 2)]
+    for row in rows:
+        lines.append(f"| {row['files']} | {row['tests']} | " + " | ".join(cell(row, stage) for stage in STAGES) + " |")
+
+    lines += ["", "## Cost per file (ms)", "",
+              "| Files | " + " | ".join(STAGES) + " |",
+              "|" + "---|" * (len(STAGES) + 1)]
+    for row in rows:
+        per_file = [f"{row[stage] * 1000 / row['files']:.2f}" if stage in row else "—" for stage in STAGES]
+        lines.append(f"| {row['files']} | " + " | ".join(per_file) + " |")
+
+    if len(rows) > 1:
+        lines += ["", "## Scaling exponent (1.0 = linear)", "",
+                  "| Files | " + " | ".join(STAGES) + " |",
+                  "|" + "---|" * (len(STAGES) + 1)]
+        for small, large in zip(rows, rows[1:]):
+            slopes = [exponent(small, large, stage) for stage in STAGES]
+            lines.append(f"| {small['files']} → {large['files']} | "
+                         + " | ".join("—" if slope is None else f"{slope:.2f}" for slope in slopes) + " |")
+
+    lines += ["", "## Curves (log-scaled wall time)", "", "```"]
+    longest = max((row[stage] for row in rows for stage in STAGES if stage in row), default=1.0)
+    for stage in STAGES:
+        lines.append(stage)
+        for row in rows:
+            if stage not in row:
+                continue
+            width = int(40 * math.log1p(row[stage] * 100) / math.log1p(longest * 100)) if longest else 0
+            lines.append(f"  {row['files']:>7} | {'#' * width} {row[stage]:.2f}s")
+    lines += ["```", ""]
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Measure how pipeline stages scale with project size")
+    parser.add_argument("--sizes", default="100,1000,5000",
+                        help="Comma-separated approximate file counts (up to 50000)")
+    parser.add_argument("--jobs", type=int, default=8, help="Concurrent generation requests")
+    parser.add_argument("--latency", type=float, default=0.0, help="Stub model latency per request (s)")
+    parser.add_argument("--include-depth", type=int, default=3)
+    parser.add_argument("--lines", type=int, default=80, help="Rough length of each synthetic file")
+    parser.add_argument("--max-build-files", type=int, default=1000,
+                        help="Only build and run the tests of outputs with at most this many test files")
+    parser.add_argument("--work-dir", help="Keep projects and outputs here (projects are reused between runs)")
+    parser.add_argument("--report", help="Write the markdown report here as well as to stdout")
+    parser.add_argument("--json", help="Write the raw measurements here")
+    args = parser.parse_args()
+
+    logging.getLogger().setLevel(logging.WARNING)
+    sizes = [int(size) for size in args.sizes.split(",") if size.strip()]
+    work = Path(args.work_dir) if args.work_dir else Path(tempfile.mkdtemp(prefix="scaling_bench_"))
+    work.mkdir(parents=True, exist_ok=True)
+    server, _ = start_stub(StubSettings(latency=args.latency))
+    rows = []
+    try:
+        for files in sizes:
+            print(f"Running {files} files...", file=sys.stderr)
+            rows.append(run_size(files, work, server.url, args))
+    finally:
+        server.shutdown()
+        if not args.work_dir:
+            shutil.rmtree(work, ignore_errors=True)
+
+    report = render_report(rows, args)
+    print(report)
+    if args.report:
+        Path(args.report).write_text(report, encoding='utf-8')
+    if args.json:
+        Path(args.json).write_text(json.dumps(rows, indent=2), encoding='utf-8')
+
+
+if __name__ == "__main__":
+    main()
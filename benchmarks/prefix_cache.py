@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+"""
+Prefix-cache benchmark for local inference servers
+Sends the initial-generation prompt of every project file to Ollama or a
+llama.cpp server, once with the legacy layout (source before the static
+instructions) and once with the current one (static prefix, source last), and
+reports prompt-cache hit rate and time to first token for each
+"""
+
+import argparse
+import json
+import sys
+import time
+import uuid
+from pathlib import Path
+from statistics import mean, median
+from typing import Any, Dict, List
+
+import requests
+
+sys.path.insert(0, str(Path(__file__).resolve().parent.parent / "src"))
+
+from test_generator import CppTestGenerator, GeneratorConfig  # noqa: E402
+
+
+def legacy_prompt(cpp_file: Path, source_code: str, instructions: Dict[str, Any]) -> str:
+    """The prompt layout used before the static prefix was moved to the front"""
+    return f"""
+{instructions['objective']}
+
+Source File: {cpp_file.name}
+Source Code:
+```cpp
+{source_code}
+```
+
+Requirements:
+{chr(10).join(f"- {req}" for req in instructions['requirements'])}
+
+Output Format:
+{instructions['output_format']}
+
+Constraints:
+{chr(10).join(f"- {const}" for const in instructions['constraints'])}
+
+Example Structure:
+{instructions['example_structure']}
+
+Please generate comprehensive unit tests for this C++ file following the above requirements.
+"""
+
+
+def shared_prefix(a: str, b: str) -> int:
+    length = min(len(a), len(b))
+    for index in range(length):
+        if a[index] != b[index]:
+            return index
+    return length
+
+
+class OllamaTarget:
+    """Measures time to first streamed token and evaluated prompt tokens via /api/generate"""
+
+    def __init__(self, url: str, model: str):
+        self.url = url.rstrip('/') + "/api/generate"
+        self.model = model
+        self.chars_per_token = None
+
+    def flush(self):
+        # A prompt sharing nothing with the next one evicts the cached prefix from the slot
+        self.send(uuid.uuid4().hex)
+        self.chars_per_token = None
+
+    def send(self, prompt: str) -> Dict[str, float]:
+        payload = {"model": self.model, "prompt": prompt, "stream": True, "keep_alive": "30m",
+                   "options": {"num_predict": 1, "temperature": 0, "num_ctx": 8192}}
+        start = time.perf_counter()
+        ttft = None
+        final = {}
+        with requests.post(self.url, json=payload, stream=True, timeout=600) as response:
+            response.raise_for_status()
+            for line in response.iter_lines():
+                if not line:
+                    continue
+                chunk = json.loads(line)
+                if ttft is None:
+                    ttft = time.perf_counter() - start
+                if chunk.get("done"):
+                    final = chunk
+        evaluated = final.get("prompt_eval_count", 0)
+        # Ollama only reports evaluated tokens, so the first (cold) prompt calibrates the total
+        if self.chars_per_token is None and evaluated:
+            self.chars_per_token = len(prompt) / evaluated
+        total = max(evaluated, round(len(prompt) / (self.chars_per_token or 4.0)))
+        return {"ttft_s": ttft or 0.0, "prompt_tokens": total, "evaluated_tokens": evaluated}
+
+
+class LlamaCppTarget:
+    """Reads cached vs evaluated prompt tokens from llama.cpp's /completion timings"""
+
+    def __init__(self, url: str):
+        self.url = url.rstrip('/') + "/completion"
+
+    def flush(self):
+        self.send(uuid.uuid4().hex)
+
+    def send(self, prompt: str) -> Dict[str, float]:
+        payload = {"prompt": prompt, "n_predict": 1, "temperature": 0, "cache_prompt": True}
+        start = time.perf_counter()
+        response = requests.post(self.url, json=payload, timeout=600)
+        response.raise_for_status()
+        ttft = time.perf_counter() - start
+        result = response.json()
+        total = result.get("tokens_evaluated", 0)
+        evaluated = result.get("timings", {}).get("prompt_n", total)
+        return {"ttft_s": ttft, "prompt_tokens": total, "evaluated_tokens": evaluated}
+
+
+class DryRunTarget:
+    """No server: the share of each prompt that matches the previous one is the best possible hit rate"""
+
+    def __init__(self):
+        self.previous = ""
+
+    def flush(self):
+        self.previous = ""
+
+    def send(self, prompt: str) -> Dict[str, float]:
+        cached = shared_prefix(self.previous, prompt)
+        self.previous = prompt
+        return {"ttft_s": 0.0, "prompt_tokens": len(prompt) // 4, "evaluated_tokens": (len(prompt) - cached) // 4}
+
+
+def run_layout(target, prompts: List[str]) -> Dict[str, float]:
+    target.flush()
+    samples = [target.send(prompt) for prompt in prompts]
+    # The first prompt is always cold; hit rate and TTFT are about the ones that follow it
+    warm = samples[1:] or samples
+    total = sum(sample["prompt_tokens"] for sample in warm)
+    evaluated = sum(sample["evaluated_tokens"] for sample in warm)
+    return {
+        "prompts": len(samples),
+        "cache_hit_rate": 1 - evaluated / total if total else 0.0,
+        "mean_ttft_s": mean(sample["ttft_s"] for sample in warm),
+        "median_ttft_s": median(sample["ttft_s"] for sample in warm),
+        "cold_ttft_s": samples[0]["ttft_s"],
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Prompt prefix-cache benchmark (legacy vs stable-prefix layout)")
+    parser.add_argument("--project-path", required=True, help="C++ project whose files are used as prompts")
+    parser.add_argument("--server", choices=['ollama', 'llamacpp', 'dry-run'], default='ollama')
+    parser.add_argument("--url", help="Server base URL (default localhost:11434 / localhost:8080)")
+    parser.add_argument("--model", default='llama3.2:latest', help="Ollama model name")
+    parser.add_argument("--limit", type=int, default=10, help="Number of project files to send")
+    parser.add_argument("--json", help="Also write the results to this file")
+    args = parser.parse_args()
+
+    config = GeneratorConfig(project_path=args.project_path, output_dir=str(Path("/tmp") / "prefix_cache_bench"),
+                             model_provider='mock', model_name='none')
+    generator = CppTestGenerator(config)
+    stage_config = generator.load_yaml_config('initial_test_generation')
+    files = sorted(generator.find_cpp_files())[:args.limit]
+    sources = [(f, generator.read_file_content(f)) for f in files]
+
+    layouts = {
+        "legacy": [legacy_prompt(f, src, stage_config['instructions']) for f, src in sources],
+        "stable-prefix": [generator._create_initial_test_prompt(f, src, stage_config) for f, src in sources],
+    }
+    if args.server == 'ollama':
+        target = OllamaTarget(args.url or "http://localhost:11434", args.model)
+    elif args.server == 'llamacpp':
+        target = LlamaCppTarget(args.url or "http://localhost:8080")
+    else:
+        target = DryRunTarget()
+
+    results = {name: run_layout(target, prompts) for name, prompts in layouts.items()}
+
+    print("| Layout | Prompts | Cache hit rate | Mean TTFT (s) | Median TTFT (s) | Cold TTFT (s) |")
+    print("|--------|---------|----------------|---------------|-----------------|---------------|")
+    for name, result in results.items():
+        print(f"| {name} | {result['prompts']} | {result['cache_hit_rate']:.1%} | {result['mean_ttft_s']:.3f} "
+              f"| {result['median_ttft_s']:.3f} | {result['cold_ttft_s']:.3f} |")
+    if args.json:
+        Path(args.json).write_text(json.dumps(results, indent=2), encoding='utf-8')
+
+
+if __name__ == "__main__":
+    main()
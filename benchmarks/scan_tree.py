@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""
+Source discovery benchmark
+Builds a synthetic project tree (default 100k files: sources, a build tree,
+.git objects, third-party headers, tests and gitignored generated code) and
+times the legacy per-extension rglob scan against the pruned single-pass walk
+"""
+
+import argparse
+import shutil
+import sys
+import tempfile
+import time
+from pathlib import Path
+from typing import Callable, List
+
+sys.path.insert(0, str(Path(__file__).resolve().parent.parent / "src"))
+
+from source_scan import DEFAULT_EXCLUDES, SourceScanner  # noqa: E402
+
+EXTENSIONS = {'.cpp', '.cc', '.cxx', '.c++', '.h', '.hpp', '.hxx', '.h++'}
+
+
+def legacy_find(project_path: Path) -> List[Path]:
+    """find_cpp_files as it was: one rglob per extension, then a substring filter"""
+    cpp_files = []
+    for ext in EXTENSIONS:
+        cpp_files.extend(project_path.rglob(f'*{ext}'))
+    return [f for f in cpp_files
+            if not any(skip in str(f).lower() for skip in ['test', 'third_party', 'build', '.git'])]
+
+
+def build_tree(root: Path, total: int):
+    """Distribute `total` files over the usual shape of a C++ repository"""
+    shares = {
+        "src": 0.20, "build": 0.45, ".git/objects": 0.20, "third_party": 0.08,
+        "tests": 0.04, "generated": 0.02, "attestation": 0.01,
+    }
+    (root / ".gitignore").write_text("generated/\n*.tmp\n", encoding='utf-8')
+    for area, share in shares.items():
+        count = max(1, int(total * share))
+        for index in range(count):
+            directory = root / area / f"d{index % 97:02d}" / f"s{index % 13}"
+            directory.mkdir(parents=True, exist_ok=True)
+            if area == ".git/objects":
+                name = f"{index:08x}"
+            elif area == "build":
+                name = f"unit{index}.o" if index % 4 else f"moc_unit{index}.cpp"
+            elif area == "src":
+                name = (f"module{index}.cpp", f"module{index}.h", f"notes{index}.md", f"module{index}.tmp")[index % 4]
+            elif area == "tests":
+                name = f"test_module{index}.cpp"
+            else:
+                name = f"{area}{index}.h" if index % 2 else f"{area}{index}.cpp"
+            (directory / name).write_bytes(b"// synthetic\n")
+
+
+def timed(label: str, fn: Callable[[], List[Path]], repeat: int) -> List[Path]:
+    best = None
+    result: List[Path] = []
+    for _ in range(repeat):
+        start = time.perf_counter()
+        result = fn()
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+    print(f"| {label} | {len(result)} | {best:.3f} |")
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark find_cpp_files on a synthetic tree")
+    parser.add_argument("--files", type=int, default=100_000, help="Files in the synthetic tree")
+    parser.add_argument("--root", help="Reuse or create the tree here instead of a temporary directory")
+    parser.add_argument("--repeat", type=int, default=3, help="Runs per scanner; the best time is reported")
+    parser.add_argument("--workers", type=int, help="Threads for the parallel walk")
+    args = parser.parse_args()
+
+    root = Path(args.root) if args.root else Path(tempfile.mkdtemp(prefix="scan_bench_"))
+    try:
+        root.mkdir(parents=True, exist_ok=True)
+        if not any(root.iterdir()):
+            start = time.perf_counter()
+            build_tree(root, args.files)
+            print(f"Built {args.files} files under {root} in {time.perf_counter() - start:.1f}s\n")
+
+        print("| Scanner | Files found | Best wall time (s) |")
+        print("|---------|-------------|--------------------|")
+        legacy = timed("legacy rglob x8 + substring filter", lambda: legacy_find(root), args.repeat)
+        current = timed("pruned parallel scandir", lambda: SourceScanner(
+            root, exclude=DEFAULT_EXCLUDES, workers=args.workers).scan(), args.repeat)
+        single = timed("pruned scandir, 1 thread", lambda: SourceScanner(
+            root, exclude=DEFAULT_EXCLUDES, workers=1).scan(), args.repeat)
+        assert sorted(current) == sorted(single)
+
+        legacy_set, current_set = set(legacy), set(current)
+        print(f"\nOnly found by the new walk (legacy 'test' substring false positives): "
+              f"{len(current_set - legacy_set)}")
+        print(f"Only found by the legacy scan (gitignored or pruned): {len(legacy_set - current_set)}")
+    finally:
+        if not args.root:
+            shutil.rmtree(root, ignore_errors=True)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""
+Stub model server for pipeline benchmarks
+Speaks Ollama's /api/generate and /api/chat and answers with a compiling gtest
+file for the synthetic class named in the prompt, after a configurable latency,
+so every pipeline stage can be exercised at scale without a model
+"""
+
+import argparse
+import hashlib
+import json
+import re
+import threading
+import time
+from dataclasses import dataclass
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from typing import Any, Dict, Optional, Tuple
+
+from synthetic_project import header_path
+
+SOURCE_FILE = re.compile(r'Source File: (\w+)\.\w+')
+TEST_FILE = re.compile(r'\btest_(\w+?)(?:_(?:h|hh|hpp|hxx|c|cc|cpp|cxx))?\.cpp\b')
+FAILING_TEST = re.compile(r'Failing Test: (\w+)Test\.(\w+)')
+
+
+@dataclass
+class StubSettings:
+    latency: float = 0.0  # seconds per request before any output
+    tokens_per_second: float = 0.0  # output speed; 0 returns the whole answer at once
+    broken_rate: float = 0.0  # share of classes whose first answer does not compile
+
+
+def test_body(class_name: str, broken: bool = False) -> str:
+    accessor = "checksumm" if broken else "checksum"
+    return (f"TEST({class_name}Test, ChecksumMatchesDeclaration) {{\n"
+            f"    {class_name} object;\n"
+            f"    EXPECT_EQ(object.{accessor}(), {class_name}::kChecksum);\n"
+            f"}}\n")
+
+
+def test_file(class_name: str, broken: bool = False) -> str:
+    return f'#include <gtest/gtest.h>\n#include "{header_path(class_name)}"\n\n{test_body(class_name, broken)}'
+
+
+def breaks_first(class_name: str, rate: float) -> bool:
+    """Stable per class, so reruns and cassettes see the same failures"""
+    return int(hashlib.sha1(class_name.encode()).hexdigest()[:8], 16) / 0xFFFFFFFF < rate
+
+
+def answer(prompt: str, settings: StubSettings) -> str:
+    """A fenced test file for the synthetic class the prompt is about; empty for anything else
+    (main.cc, core/Http.h, other projects), which the pipeline's gate rejects like a bad answer"""
+    failing = FAILING_TEST.search(prompt)
+    if failing and header_path(failing.group(1)):
+        # Per-test regeneration after a build failure: always fixed
+        return f"```cpp\n{test_body(failing.group(1))}```"
+    source = SOURCE_FILE.search(prompt)
+    if source and header_path(source.group(1)):
+        class_name = source.group(1)
+        return f"```cpp\n{test_file(class_name, breaks_first(class_name, settings.broken_rate))}```"
+    existing = TEST_FILE.search(prompt)
+    if existing and header_path(existing.group(1)):
+        return f"```cpp\n{test_file(existing.group(1))}```"
+    return ""
+
+
+class _Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"  # keep-alive, like a real server behind requests.Session
+
+    def do_POST(self):
+        body = json.loads(self.rfile.read(int(self.headers.get('Content-Length', 0))) or b"{}")
+        settings: StubSettings = self.server.settings
+        if "messages" in body:
+            prompt = "\n\n".join(message.get("content", "") for message in body["messages"])
+        else:
+            prompt = body.get("prompt", "")
+        text = answer(prompt, settings) if prompt else ""
+        delay = settings.latency if prompt else 0.0
+        if settings.tokens_per_second > 0:
+            delay += len(text) / 4 / settings.tokens_per_second
+        time.sleep(delay)
+        result: Dict[str, Any] = {"model": body.get("model", "stub"), "done": True,
+                                  "prompt_eval_count": len(prompt) // 4, "eval_count": len(text) // 4,
+                                  "load_duration": 0}
+        if self.path.endswith("/api/chat"):
+            result["message"] = {"role": "assistant", "content": text}
+        else:
+            result["response"] = text
+        self.server.count()
+        self._reply(result)
+
+    def do_GET(self):
+        self._reply({"models": [{"name": "stub"}]})
+
+    def _reply(self, payload: Dict[str, Any]):
+        data = json.dumps(payload).encode('utf-8')
+        self.send_response(200)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+    def log_message(self, *args):
+        pass
+
+
+class StubServer(ThreadingHTTPServer):
+    daemon_threads = True
+
+    def __init__(self, port: int, settings: StubSettings):
+        super().__init__(("127.0.0.1", port), _Handler)
+        self.settings = settings
+        self.requests = 0
+        self._lock = threading.Lock()
+
+    def count(self):
+        with self._lock:
+            self.requests += 1
+
+    @property
+    def url(self) -> str:
+        return f"http://127.0.0.1:{self.server_address[1]}/api/generate"
+
+
+def start_stub(settings: Optional[StubSettings] = None, port: int = 0) -> Tuple[StubServer, threading.Thread]:
+    """Serve in a background thread; port 0 picks a free one (see server.url)"""
+    server = StubServer(port, settings or StubSettings())
+    thread = threading.Thread(target=server.serve_forever, daemon=True)
+    thread.start()
+    return server, thread
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Ollama-compatible stub model for synthetic projects")
+    parser.add_argument("--port", type=int, default=11435)
+    parser.add_argument("--latency", type=float, default=0.0, help="Seconds before each answer")
+    parser.add_argument("--tokens-per-second", type=float, default=0.0, help="Simulated output speed; 0 is instant")
+    parser.add_argument("--broken-rate", type=float, default=0.0,
+                        help="Share of classes whose first test does not compile, to exercise build fixing")
+    args = parser.parse_args()
+
+    server = StubServer(args.port, StubSettings(args.latency, args.tokens_per_second, args.broken_rate))
+    print(f"Stub model listening on {server.url}")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
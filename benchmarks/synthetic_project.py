@@ -0,0 +1,307 @@
+#!/usr/bin/env python3
+"""
+Synthetic Drogon-style C++ projects
+Writes controllers, ORM-like models, filters and header-only utilities in the
+layout of orgChartApi, at any size from a hundred to tens of thousands of files,
+with configurable include depth and file size. Every class is self-contained
+(its own small HTTP framework stands in for Drogon) so generated tests build
+"""
+
+import argparse
+import random
+import sys
+import time
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Optional
+
+FRAMEWORK_HEADER = "core/Http.h"
+
+FRAMEWORK = """#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+// Minimal stand-in for the parts of Drogon the synthetic controllers use
+namespace web {
+
+enum class HttpStatusCode { k200OK = 200, k400BadRequest = 400, k401Unauthorized = 401, k404NotFound = 404 };
+
+struct HttpRequest {
+    std::string path;
+    std::map<std::string, std::string> parameters;
+    std::string getParameter(const std::string &key) const {
+        auto it = parameters.find(key);
+        return it == parameters.end() ? std::string() : it->second;
+    }
+};
+
+struct HttpResponse {
+    HttpStatusCode status = HttpStatusCode::k200OK;
+    std::string body;
+};
+
+using HttpRequestPtr = std::shared_ptr<HttpRequest>;
+using HttpResponsePtr = std::shared_ptr<HttpResponse>;
+using ResponseCallback = std::function<void(const HttpResponsePtr &)>;
+
+inline HttpResponsePtr makeResponse(HttpStatusCode status, std::string body) {
+    auto response = std::make_shared<HttpResponse>();
+    response->status = status;
+    response->body = std::move(body);
+    return response;
+}
+
+template <typename T>
+class HttpController {
+public:
+    static constexpr bool isAutoCreation = true;
+};
+
+class HttpFilterBase {
+public:
+    virtual ~HttpFilterBase() = default;
+    virtual bool allow(const HttpRequest &request) const = 0;
+};
+
+// A concrete collaborator without a default constructor: its shared mock has to inherit the constructor
+class RateLimiter {
+public:
+    explicit RateLimiter(int perMinute) : perMinute_(perMinute) {}
+    virtual ~RateLimiter() = default;
+    virtual bool admit(const HttpRequest &request) { return perMinute_ > 0 && !request.path.empty(); }
+    int perMinute() const { return perMinute_; }
+
+private:
+    int perMinute_;
+};
+
+}  // namespace web
+"""
+
+
+@dataclass
+class ProjectShape:
+    """How many of each kind of file to write and how large to make them"""
+    controllers: int = 20
+    models: int = 20
+    filters: int = 4
+    utils: int = 10
+    include_depth: int = 3  # levels of utility headers including each other
+    lines: int = 80  # rough target length of each file
+    seed: int = 0
+
+    @classmethod
+    def for_files(cls, total: int, **overrides) -> "ProjectShape":
+        """A shape with about `total` files: 20% utility headers, the rest .h/.cc pairs split 45/45/10"""
+        utils = max(1, total // 5)
+        pairs = max(3, (total - utils - 2) // 2)
+        controllers = max(1, pairs * 45 // 100)
+        models = max(1, pairs * 45 // 100)
+        filters = max(1, pairs - controllers - models)
+        return cls(controllers=controllers, models=models, filters=filters, utils=utils, **overrides)
+
+    @property
+    def files(self) -> int:
+        return 2 * (self.controllers + self.models + self.filters) + self.utils + 2
+
+
+def header_path(class_name: str) -> Optional[str]:
+    """Project-relative header declaring a synthetic class; shared with the stub model server"""
+    for prefix, directory in (("Resource", "controllers"), ("Model", "models"),
+                              ("Filter", "filters"), ("Util", "utils")):
+        if class_name.startswith(prefix) and class_name[len(prefix):len(prefix) + 1].isdigit():
+            return f"{directory}/{class_name}.h"
+    return None
+
+
+def util_name(index: int, depth: int) -> str:
+    return f"Util{index % depth}_{index}"
+
+
+def util_level(name: str) -> int:
+    return int(name[len("Util"):].split("_")[0])
+
+
+class ProjectWriter:
+    def __init__(self, root: Path, shape: ProjectShape):
+        self.root = Path(root)
+        self.shape = shape
+        self.random = random.Random(shape.seed)
+        self.depth = max(1, shape.include_depth)
+        self.utils_by_level = {}
+        for index in range(shape.utils):
+            name = util_name(index, self.depth)
+            self.utils_by_level.setdefault(util_level(name), []).append(name)
+        self.written = 0
+
+    def write(self, relative: str, content: str):
+        path = self.root / relative
+        path.parent.mkdir(parents=True, exist_ok=True)
+        path.write_text(content, encoding='utf-8')
+        self.written += 1
+
+    def pick_util(self, below: Optional[int] = None) -> Optional[str]:
+        """A utility header at the deepest level under `below`, so include chains reach the configured depth"""
+        levels = [level for level in self.utils_by_level if below is None or level < below]
+        if not levels:
+            return None
+        return self.random.choice(self.utils_by_level[max(levels)])
+
+    def members(self, overhead: int, per_member: int) -> int:
+        return max(1, (self.shape.lines - overhead) // per_member + self.random.randint(-1, 1))
+
+    def run(self) -> int:
+        self.write(FRAMEWORK_HEADER, FRAMEWORK)
+        for index in range(self.shape.utils):
+            self.write_util(util_name(index, self.depth))
+        for index in range(self.shape.models):
+            self.write_model(index)
+        for index in range(self.shape.filters):
+            self.write_filter(index)
+        for index in range(self.shape.controllers):
+            self.write_controller(index)
+        self.write_main()
+        return self.written
+
+    @staticmethod
+    def checksum(name: str) -> int:
+        return sum(map(ord, name)) % 9973
+
+    def write_util(self, name: str):
+        level = util_level(name)
+        include = self.pick_util(below=level)
+        functions = self.members(12, 6)
+        lines = ["#pragma once", "", "#include <string>", "#include <vector>"]
+        if include:
+            lines.append(f'#include "utils/{include}.h"')
+        lines += ["", f"struct {name} {{", f"    static constexpr int kChecksum = {self.checksum(name)};",
+                  "    int checksum() const { return kChecksum; }"]
+        for number in range(functions):
+            inner = f"{include}().checksum()" if include else str(number)
+            lines += [f"    static std::string format{number}(const std::string &value) {{",
+                      f"        std::string out = \"{name}:{number}:\" + value;",
+                      f"        out += std::to_string({inner});",
+                      "        return out;",
+                      "    }"]
+        lines += ["};", ""]
+        self.write(f"utils/{name}.h", "\n".join(lines))
+
+    def write_model(self, index: int):
+        name = f"Model{index}"
+        util = self.pick_util()
+        fields = self.members(30, 8)
+        header = ["#pragma once", "", "#include <cstdint>", "#include <string>"]
+        if util:
+            header.append(f'#include "utils/{util}.h"')
+        header += ["", f"class {name} {{", "public:",
+                   f"    static constexpr int kChecksum = {self.checksum(name)};",
+                   f"    static constexpr int kColumns = {fields};",
+                   "    int checksum() const { return kChecksum; }",
+                   "    int columnCount() const { return kColumns; }", ""]
+        source = [f'#include "models/{name}.h"', ""]
+        for field in range(fields):
+            column = f"column{field}"
+            header += [f"    const std::string &get{column.capitalize()}() const;",
+                       f"    void set{column.capitalize()}(const std::string &value);"]
+            source += [f"const std::string &{name}::get{column.capitalize()}() const {{",
+                       f"    return {column}_;", "}", "",
+                       f"void {name}::set{column.capitalize()}(const std::string &value) {{",
+                       f"    {column}_ = value;", "}", ""]
+        header += ["", "private:"] + [f"    std::string column{field}_;" for field in range(fields)] + ["};", ""]
+        self.write(f"models/{name}.h", "\n".join(header))
+        self.write(f"models/{name}.cc", "\n".join(source))
+
+    def write_filter(self, index: int):
+        name = f"Filter{index}"
+        header = ["#pragma once", "", f'#include "{FRAMEWORK_HEADER}"', "",
+                  f"class {name} : public web::HttpFilterBase {{", "public:",
+                  f"    static constexpr int kChecksum = {self.checksum(name)};",
+                  "    int checksum() const { return kChecksum; }",
+                  "    // Virtual functions stay inline: generated tests link headers only, never project sources",
+                  "    bool allow(const web::HttpRequest &request) const override {",
+                  f"        return !request.getParameter(\"token{index}\").empty();",
+                  "    }",
+                  "    std::string token(const web::HttpRequest &request) const;", "};", ""]
+        source = [f'#include "filters/{name}.h"', "",
+                  f"std::string {name}::token(const web::HttpRequest &request) const {{",
+                  f"    return request.getParameter(\"token{index}\");", "}", ""]
+        self.write(f"filters/{name}.h", "\n".join(header))
+        self.write(f"filters/{name}.cc", "\n".join(source))
+
+    def write_controller(self, index: int):
+        name = f"Resource{index}Controller"
+        model = f"Model{index % max(1, self.shape.models)}"
+        util = self.pick_util()
+        handlers = self.members(20, 12)
+        header = ["#pragma once", "", f'#include "{FRAMEWORK_HEADER}"', f'#include "models/{model}.h"']
+        if util:
+            header.append(f'#include "utils/{util}.h"')
+        header += ["", f"class {name} : public web::HttpController<{name}> {{", "public:",
+                   f"    static constexpr int kChecksum = {self.checksum(name)};",
+                   f"    static constexpr int kRoutes = {handlers};",
+                   "    int checksum() const { return kChecksum; }",
+                   "    int routeCount() const { return kRoutes; }", ""]
+        source = [f'#include "controllers/{name}.h"', ""]
+        if self.shape.filters:
+            source.insert(1, f'#include "filters/Filter{index % self.shape.filters}.h"')
+        for handler in range(handlers):
+            header.append(f"    void handle{handler}(const web::HttpRequestPtr &request, "
+                          "web::ResponseCallback &&callback) const;")
+            source += [f"void {name}::handle{handler}(const web::HttpRequestPtr &request, "
+                       "web::ResponseCallback &&callback) const {",
+                       f"    {model} item;",
+                       f"    const auto id = request->getParameter(\"id{handler}\");",
+                       "    if (id.empty()) {",
+                       "        callback(web::makeResponse(web::HttpStatusCode::k400BadRequest, \"missing id\"));",
+                       "        return;",
+                       "    }",
+                       "    item.setColumn0(id);",
+                       "    callback(web::makeResponse(web::HttpStatusCode::k200OK, item.getColumn0()));",
+                       "}", ""]
+        header += ["};", ""]
+        self.write(f"controllers/{name}.h", "\n".join(header))
+        self.write(f"controllers/{name}.cc", "\n".join(source))
+
+    def write_main(self):
+        self.write("main.cc", "\n".join([
+            f'#include "{FRAMEWORK_HEADER}"', "", "int main() {", "    return 0;", "}", ""]))
+
+
+def generate_project(root: Path, shape: ProjectShape) -> int:
+    """Write a synthetic project under root and return the number of files written"""
+    return ProjectWriter(root, shape).run()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Write a synthetic Drogon-style C++ project")
+    parser.add_argument("root", help="Directory to write the project into")
+    parser.add_argument("--files", type=int, help="Approximate total file count; sets the counts below")
+    parser.add_argument("--controllers", type=int, default=20)
+    parser.add_argument("--models", type=int, default=20)
+    parser.add_argument("--filters", type=int, default=4)
+    parser.add_argument("--utils", type=int, default=10, help="Header-only utility classes")
+    parser.add_argument("--include-depth", type=int, default=3, help="Levels of utility headers including each other")
+    parser.add_argument("--lines", type=int, default=80, help="Rough target length of each file")
+    parser.add_argument("--seed", type=int, default=0)
+    args = parser.parse_args()
+
+    sizing = dict(include_depth=args.include_depth, lines=args.lines, seed=args.seed)
+    if args.files:
+        shape = ProjectShape.for_files(args.files, **sizing)
+    else:
+        shape = ProjectShape(controllers=args.controllers, models=args.models, filters=args.filters,
+                             utils=args.utils, **sizing)
+    root = Path(args.root)
+    if root.exists() and any(root.iterdir()):
+        sys.exit(f"{root} is not empty")
+    start = time.perf_counter()
+    written = generate_project(root, shape)
+    print(f"Wrote {written} files ({shape.controllers} controllers, {shape.models} models, "
+          f"{shape.filters} filters, {shape.utils} utilities) to {root} in {time.perf_counter() - start:.1f}s")
+
+
+if __name__ == "__main__":
+    main()
@@ -23,7 +23,7 @@ class MockLLMProvider:
     def generate_response(self, prompt: str, system_prompt: str = "") -> str:
         """Generate mock response based on the prompt type"""
         
-        if "test_main.cpp" in prompt or "main.cc" in prompt:
+        if "Source File: main.cc" in prompt:
             return self._generate_main_test()
         elif "PersonsController" in prompt:
             return self._generate_controller_test()
@@ -38,14 +38,17 @@ class MockLLMProvider:
         elif "coverage" in prompt.lower():
             return self._generate_coverage_improvement()
         else:
-            return self._generate_generic_test()
+            return self._generate_generic_test(prompt)
     
     def _generate_main_test(self) -> str:
         return '''#include <gtest/gtest.h>
 #include <gmock/gmock.h>
+#include <drogon/drogon.h>
+
+#include <stdexcept>
 
 // Note: main.cc primarily contains application startup code
-// These tests focus on testable components and initialization
+// These tests cover the app() setup it relies on without starting the server
 
 class MainAppTest : public ::testing::Test {
 protected:
@@ -58,16 +61,14 @@ protected:
     }
 };
 
-TEST_F(MainAppTest, ApplicationStartup_ValidConfig_InitializesSuccessfully) {
-    // Test that the application can be initialized with valid configuration
-    // This is a placeholder test as main() primarily starts the server
-    EXPECT_TRUE(true); // Placeholder assertion
+TEST_F(MainAppTest, ApplicationStartup_BeforeRun_IsNotRunning) {
+    // main() configures app() before calling run(); until then no event loop is started
+    EXPECT_FALSE(drogon::app().isRunning());
 }
 
-TEST_F(MainAppTest, ConfigFile_Loading_ReturnsValidConfiguration) {
-    // Test configuration file loading
-    // This would need to be extracted into a testable function
-    EXPECT_TRUE(true); // Placeholder assertion
+TEST_F(MainAppTest, ConfigFile_MissingFile_Throws) {
+    // Drogon rejects a config path that does not exist
+    EXPECT_THROW(drogon::app().loadConfigFile("missing_config.json"), std::runtime_error);
 }
 
 // Note: For better testability, consider extracting application logic
@@ -419,26 +420,30 @@ TEST_F(DepartmentTest, ToJson_ValidDepartment_ReturnsValidJson) {
 }
 '''
     
-    def _generate_generic_test(self) -> str:
-        return '''#include <gtest/gtest.h>
+    def _generate_generic_test(self, prompt: str) -> str:
+        source = next((line.split(':', 1)[1].strip() for line in prompt.splitlines()
+                       if line.startswith("Source File:")), "Unknown.h")
+        class_name = Path(source.split()[0]).stem
+        return f'''#include <gtest/gtest.h>
 #include <gmock/gmock.h>
+#include <type_traits>
+#include "{class_name}.h"
 
-// Generic test template
-class GenericTest : public ::testing::Test {
+// Generic test template: checks what every class under test must provide
+class GenericTest : public ::testing::Test {{
 protected:
-    void SetUp() override {
+    void SetUp() override {{
         // Setup code
-    }
+    }}
     
-    void TearDown() override {
+    void TearDown() override {{
         // Cleanup code
-    }
-};
+    }}
+}};
 
-TEST_F(GenericTest, BasicFunctionality_ValidInput_ReturnsExpected) {
-    // Test implementation
-    EXPECT_TRUE(true);
-}
+TEST_F(GenericTest, {class_name}_IsDestructible) {{
+    EXPECT_TRUE(std::is_destructible<{class_name}>::value);
+}}
 '''
     
     def _generate_refinement_response(self) -> str:
@@ -461,15 +466,22 @@ Reason: Required for std::unique_ptr and std::function
     
     def _generate_coverage_improvement(self) -> str:
         return '''// Additional tests for improved coverage
+#include <gtest/gtest.h>
+#include <limits>
+#include "models/Person.h"
+
+using namespace drogon_model::org_chart;
 
-TEST_F(PersonsControllerTest, ErrorHandling_DatabaseError_ReturnsInternalError) {
-    // Test database error scenarios
-    EXPECT_TRUE(true);
+TEST(PersonCoverageTest, BoundaryValues_MaxIntId_HandlesCorrectly) {
+    Person person;
+    person.setId(std::numeric_limits<int32_t>::max());
+    EXPECT_EQ(person.getValueOfId(), std::numeric_limits<int32_t>::max());
 }
 
-TEST_F(PersonTest, BoundaryValues_MaxIntId_HandlesCorrectly) {
-    // Test boundary value for ID
-    EXPECT_TRUE(true);
+TEST(PersonCoverageTest, SetFirstName_EmptyString_StoresEmptyName) {
+    Person person;
+    person.setFirstName("");
+    EXPECT_EQ(person.getValueOfFirstName(), "");
 }
 '''
 
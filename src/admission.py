@@ -0,0 +1,89 @@
+"""
+Token-budget admission control
+Requests are admitted by weight (estimated prompt tokens plus max_tokens) against
+a per-provider budget, so many small prompts can run side by side while large
+ones wait for room instead of overloading a local server or a TPM quota
+"""
+
+import time
+import threading
+from contextlib import contextmanager
+from typing import Dict, Iterator, List, Optional
+
+
+class WeightedSemaphore:
+    """Semaphore whose permits are tokens; requests heavier than the budget run alone"""
+
+    def __init__(self, capacity: int, starvation_s: float = 30.0):
+        self.capacity = max(1, int(capacity))
+        self.starvation_s = starvation_s
+        self.in_use = 0
+        self.peak = 0
+        self._cond = threading.Condition()
+        self._waiting: List[tuple] = []  # (arrival time, weight), oldest first
+
+    def _admissible(self, ticket: tuple) -> bool:
+        if self.in_use + ticket[1] > self.capacity:
+            return False
+        # Once the oldest waiter has waited too long, nobody overtakes it
+        oldest = self._waiting[0]
+        return ticket is oldest or time.monotonic() - oldest[0] < self.starvation_s
+
+    def acquire(self, weight: int) -> float:
+        """Block until the weight fits; returns seconds spent waiting"""
+        weight = min(max(1, int(weight)), self.capacity)
+        ticket = (time.monotonic(), weight)
+        with self._cond:
+            self._waiting.append(ticket)
+            try:
+                while not self._admissible(ticket):
+                    self._cond.wait(timeout=1.0)
+            finally:
+                self._waiting.remove(ticket)
+            self.in_use += weight
+            self.peak = max(self.peak, self.in_use)
+        return time.monotonic() - ticket[0]
+
+    def release(self, weight: int):
+        weight = min(max(1, int(weight)), self.capacity)
+        with self._cond:
+            self.in_use -= weight
+            self._cond.notify_all()
+
+    @contextmanager
+    def admit(self, weight: int) -> Iterator[float]:
+        waited = self.acquire(weight)
+        try:
+            yield waited
+        finally:
+            self.release(weight)
+
+
+class AdmissionController:
+    """One token budget per provider; providers without a budget are not throttled"""
+
+    def __init__(self, budgets: Optional[Dict[str, int]] = None):
+        self.budgets = {name: int(value) for name, value in (budgets or {}).items() if value}
+        self._semaphores: Dict[str, WeightedSemaphore] = {}
+        self._lock = threading.Lock()
+
+    def semaphore(self, provider: str) -> Optional[WeightedSemaphore]:
+        if provider not in self.budgets:
+            return None
+        with self._lock:
+            if provider not in self._semaphores:
+                self._semaphores[provider] = WeightedSemaphore(self.budgets[provider])
+            return self._semaphores[provider]
+
+    @contextmanager
+    def admit(self, provider: str, weight: int) -> Iterator[float]:
+        semaphore = self.semaphore(provider)
+        if semaphore is None:
+            yield 0.0
+            return
+        with semaphore.admit(weight) as waited:
+            yield waited
+
+    def peaks(self) -> Dict[str, int]:
+        with self._lock:
+            return {name: semaphore.peak for name, semaphore in self._semaphores.items()}
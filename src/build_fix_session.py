@@ -0,0 +1,90 @@
+"""
+Multi-turn build-fix conversations
+One chat per failing test file: the first turn carries the file and its errors,
+later turns only the diagnostics reported since the previous attempt
+"""
+
+import re
+from pathlib import Path
+from typing import Dict, List, Optional, Tuple
+
+ERROR_LINE_PATTERN = re.compile(r'^(?P<path>[^\s:]+\.(?:cpp|cc|cxx|h|hpp)):\d+(?::\d+)?: (?:fatal )?error: ')
+LOCATION_PATTERN = re.compile(r':\d+(?::\d+)?:')
+CONTEXT_LINES = 3  # caret and source lines kept after each error
+MAX_DIAGNOSTICS = 40  # per file and turn; the first errors are the ones worth fixing
+
+
+def diagnostics_by_file(build_output: str) -> Dict[str, List[str]]:
+    """Group compiler errors, with the snippet lines that follow them, by file name"""
+    grouped: Dict[str, List[str]] = {}
+    lines = build_output.splitlines()
+    for index, line in enumerate(lines):
+        match = ERROR_LINE_PATTERN.match(line)
+        if not match:
+            continue
+        context = []
+        for follow in lines[index + 1:index + 1 + CONTEXT_LINES]:
+            if not follow.startswith(' '):
+                break
+            context.append(follow)
+        entries = grouped.setdefault(Path(match.group('path')).name, [])
+        if len(entries) < MAX_DIAGNOSTICS:
+            entries.append("\n".join([line] + context))
+    return grouped
+
+
+def flatten_messages(messages: List[Dict[str, str]]) -> Tuple[str, str]:
+    """Render a chat as (prompt, system prompt) for providers without a chat endpoint"""
+    system = "\n\n".join(m["content"] for m in messages if m["role"] == "system")
+    turns = [f"{m['role'].upper()}:\n{m['content']}" for m in messages if m["role"] != "system"]
+    return "\n\n".join(turns), system
+
+
+class BuildFixSession:
+    """Chat history for repairing one test file across build attempts"""
+
+    def __init__(self, test_file: str, system_prompt: str, keep_turns: int = 2):
+        self.test_file = test_file
+        self.keep_turns = keep_turns
+        self.messages: List[Dict[str, str]] = [{"role": "system", "content": system_prompt}]
+        self.provider: Optional[tuple] = None  # (provider, provider name, model name), pinned on the first turn
+        self.turns = 0
+        self._sent = set()
+
+    @staticmethod
+    def _key(diagnostic: str) -> str:
+        # Line numbers shift as the file is edited; the message text identifies the error
+        return LOCATION_PATTERN.sub(':', diagnostic.splitlines()[0])
+
+    def new_diagnostics(self, diagnostics: List[str]) -> List[str]:
+        """Diagnostics not sent in an earlier turn"""
+        return [d for d in diagnostics if self._key(d) not in self._sent]
+
+    def mark_sent(self, diagnostics: List[str]):
+        self._sent.update(self._key(d) for d in diagnostics)
+
+    def follow_up(self, diagnostics: List[str]) -> str:
+        """Turn text for a repair iteration after the first"""
+        fresh = self.new_diagnostics(diagnostics)
+        repeated = len(diagnostics) - len(fresh)
+        parts = [f"The build still fails for {self.test_file}."]
+        if fresh:
+            parts.append("New errors:\n```\n" + "\n".join(fresh) + "\n```")
+        if repeated:
+            parts.append(f"{repeated} error(s) you were already shown are still reported.")
+        parts.append("Reply with the complete corrected test file only.")
+        return "\n\n".join(parts)
+
+    def ask(self, content: str):
+        self.messages.append({"role": "user", "content": content})
+        self.turns += 1
+
+    def answer(self, content: str):
+        self.messages.append({"role": "assistant", "content": content})
+
+    def history(self) -> List[Dict[str, str]]:
+        """System prompt, the first turn (instructions and file), and the latest exchanges"""
+        head = self.messages[:2]
+        tail = self.messages[2:]
+        keep = self.keep_turns * 2  # latest replies with the questions that followed them; roles keep alternating
+        return head + tail[-keep:] if len(tail) > keep else list(self.messages)
@@ -0,0 +1,114 @@
+"""
+Provider cassettes
+Gzip-compressed JSONL recordings of model requests, responses and latencies, so
+a pipeline run can be replayed without a model for reproducible benchmarks
+"""
+
+import os
+import gzip
+import json
+import time
+import logging
+import threading
+from pathlib import Path
+from typing import Any, Dict, List, Optional, Tuple
+
+from singleflight import request_key
+
+logger = logging.getLogger(__name__)
+
+CASSETTE_VERSION = 1
+
+
+def cassette_key(model_name: str, seed: Optional[int], system_prompt: str, prompt: str) -> str:
+    """Identify a recorded request; temperature and max_tokens are left out so tuning them keeps replays valid"""
+    return request_key(model_name, seed, system_prompt, prompt)
+
+
+def chat_key(model_name: str, seed: Optional[int], messages: List[Dict[str, str]]) -> str:
+    return request_key(model_name, seed, json.dumps(messages, sort_keys=True))
+
+
+class CassetteWriter:
+    """Appends one record per call; each record is its own gzip member written with a single O_APPEND write,
+    so worker processes recording into the same file never interleave and a killed run keeps what it recorded"""
+
+    def __init__(self, path: Path):
+        self.path = Path(path)
+        self.path.parent.mkdir(parents=True, exist_ok=True)
+        self._fd = os.open(self.path, os.O_WRONLY | os.O_CREAT | os.O_APPEND, 0o644)
+        self._lock = threading.Lock()
+        self.records = 0
+        if os.fstat(self._fd).st_size == 0:
+            self._append({"version": CASSETTE_VERSION, "created": time.time()})
+
+    def _append(self, record: Dict[str, Any]):
+        data = gzip.compress((json.dumps(record) + "\n").encode('utf-8'))
+        with self._lock:
+            os.write(self._fd, data)
+
+    def record(self, key: str, model_name: str, request: Dict[str, Any], response: str, latency: float):
+        self._append({"key": key, "model": model_name, "request": request,
+                      "response": response, "latency_s": round(latency, 4)})
+        self.records += 1
+
+    def close(self):
+        with self._lock:
+            if self._fd >= 0:
+                os.close(self._fd)
+                self._fd = -1
+
+
+class Cassette:
+    """Recorded responses by request key; repeated requests are answered in recorded order"""
+
+    def __init__(self, path: Path):
+        self.path = Path(path)
+        self._responses: Dict[str, List[Tuple[str, float]]] = {}
+        self._by_prompt: Dict[str, List[Tuple[str, float]]] = {}  # same request under any model
+        self._served: Dict[Tuple[str, str], int] = {}
+        self._lock = threading.Lock()
+        self.hits = 0
+        self.misses = 0
+        self._load()
+
+    def _load(self):
+        with gzip.open(self.path, 'rt', encoding='utf-8') as f:
+            for line in f:
+                record = json.loads(line)
+                if "version" in record:
+                    if record["version"] > CASSETTE_VERSION:
+                        raise ValueError(f"{self.path} is cassette version {record['version']}, "
+                                         f"this generator reads up to {CASSETTE_VERSION}")
+                    continue
+                entry = (record["response"], record.get("latency_s", 0.0))
+                self._responses.setdefault(record["key"], []).append(entry)
+                self._by_prompt.setdefault(self._prompt_key(record["request"]), []).append(entry)
+        logger.info(f"Loaded {len(self)} recorded responses from {self.path}")
+
+    @staticmethod
+    def _prompt_key(request: Dict[str, Any]) -> str:
+        if "messages" in request:
+            return request_key(json.dumps(request["messages"], sort_keys=True))
+        return request_key(request.get("system_prompt", ""), request.get("prompt", ""))
+
+    def lookup(self, key: str, request: Dict[str, Any]) -> Optional[Tuple[str, float]]:
+        """(response, recorded latency) for a request, or None when it was never recorded.
+        Falls back to the same prompt under another model, since latency-based routing may pick differently"""
+        with self._lock:
+            served = ("key", key)
+            entries = self._responses.get(key)
+            if entries is None:
+                prompt_key = self._prompt_key(request)
+                served = ("prompt", prompt_key)
+                entries = self._by_prompt.get(prompt_key)
+            if not entries:
+                self.misses += 1
+                return None
+            index = self._served.get(served, 0)
+            self._served[served] = index + 1
+            self.hits += 1
+            return entries[min(index, len(entries) - 1)]
+
+    def __len__(self) -> int:
+        return sum(len(entries) for entries in self._responses.values())
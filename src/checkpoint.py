@@ -0,0 +1,150 @@
+"""
+Pipeline checkpoints
+Per-file stage state (generated, refined, compiled, passed) and completed pipeline
+steps journaled to SQLite in the output directory, so an interrupted run can be
+resumed where it stopped; test files are written atomically
+"""
+
+import os
+import time
+import sqlite3
+import logging
+import tempfile
+import threading
+from pathlib import Path
+from typing import Dict, Iterable, Optional
+
+logger = logging.getLogger(__name__)
+
+CHECKPOINT_NAME = ".pipeline_state.db"
+
+# Each stage implies the ones before it; 'quarantined' sources got an answer no gate accepted,
+# which is finished work too, so a resumed run does not ask again; 'refine_rejected' is the
+# same for a refinement whose every answer was rejected and that left the file as generated
+STAGE_ORDER = ('quarantined', 'generated', 'refine_rejected', 'refined', 'compiled', 'passed')
+
+SCHEMA = """
+CREATE TABLE IF NOT EXISTS files (
+    test_file TEXT PRIMARY KEY,
+    source TEXT,
+    digest TEXT,
+    stage TEXT NOT NULL,
+    updated REAL NOT NULL
+);
+CREATE TABLE IF NOT EXISTS steps (
+    name TEXT PRIMARY KEY,
+    completed REAL NOT NULL
+);
+"""
+
+
+def write_atomic(path: Path, content: str):
+    """Write via a temporary file in the same directory and rename it over the target"""
+    path = Path(path)
+    fd, temp = tempfile.mkstemp(prefix=f".{path.name}.", suffix=".tmp", dir=path.parent)
+    try:
+        with os.fdopen(fd, 'w', encoding='utf-8') as f:
+            f.write(content)
+            f.flush()
+            os.fsync(f.fileno())
+        os.replace(temp, path)
+    except BaseException:
+        try:
+            os.unlink(temp)
+        except OSError:
+            pass
+        raise
+
+
+class Checkpoint:
+    """SQLite journal of per-test-file stages and finished pipeline steps"""
+
+    def __init__(self, path: Path):
+        self.path = Path(path)
+        self._lock = threading.Lock()
+        self._db = sqlite3.connect(str(self.path), timeout=30.0, check_same_thread=False, isolation_level=None)
+        self._db.execute("PRAGMA journal_mode=WAL")
+        self._db.execute("PRAGMA synchronous=NORMAL")
+        self._db.executescript(SCHEMA)
+
+    def forget(self, test_files: Iterable[str]):
+        """Drop the given files and the finished steps; a run without --resume starts its targets from scratch"""
+        with self._lock:
+            self._db.execute("BEGIN")
+            try:
+                self._db.executemany("DELETE FROM files WHERE test_file = ?", ((name,) for name in test_files))
+                self._db.execute("DELETE FROM steps")
+                self._db.execute("COMMIT")
+            except BaseException:
+                self._db.execute("ROLLBACK")
+                raise
+
+    def stage(self, test_file: str) -> Optional[str]:
+        with self._lock:
+            row = self._db.execute("SELECT stage FROM files WHERE test_file = ?", (test_file,)).fetchone()
+        return row[0] if row else None
+
+    def reached(self, test_file: str, stage: str, digest: Optional[str] = None, source: Optional[str] = None) -> bool:
+        """True if the file got at least as far as stage (from the given source and digest, if passed)"""
+        with self._lock:
+            row = self._db.execute("SELECT stage, digest, source FROM files WHERE test_file = ?",
+                                   (test_file,)).fetchone()
+        if row is None or (digest is not None and row[1] != digest) or (source is not None and row[2] != source):
+            return False
+        return STAGE_ORDER.index(row[0]) >= STAGE_ORDER.index(stage)
+
+    def entry(self, test_file: str) -> Optional[Dict[str, str]]:
+        with self._lock:
+            row = self._db.execute("SELECT source, digest, stage FROM files WHERE test_file = ?",
+                                   (test_file,)).fetchone()
+        return dict(zip(("source", "digest", "stage"), row)) if row else None
+
+    def mark(self, test_file: str, stage: str, source: Optional[str] = None, digest: Optional[str] = None):
+        """Record that a file reached stage; a new 'generated' also invalidates the finished pipeline steps"""
+        if stage not in STAGE_ORDER:
+            raise ValueError(f"Unknown stage: {stage}")
+        with self._lock:
+            self._db.execute(
+                "INSERT INTO files (test_file, source, digest, stage, updated) VALUES (?, ?, ?, ?, ?) "
+                "ON CONFLICT(test_file) DO UPDATE SET stage = excluded.stage, updated = excluded.updated, "
+                "source = COALESCE(excluded.source, source), digest = COALESCE(excluded.digest, digest)",
+                (test_file, source, digest, stage, time.time()))
+            if stage == 'generated':
+                self._db.execute("DELETE FROM steps")
+
+    def mark_all(self, test_files: Iterable[str], stage: str):
+        """Advance several files in one transaction, never moving a file backwards"""
+        rank = STAGE_ORDER.index(stage)
+        with self._lock:
+            self._db.execute("BEGIN")
+            try:
+                for test_file in test_files:
+                    row = self._db.execute("SELECT stage FROM files WHERE test_file = ?", (test_file,)).fetchone()
+                    if row is None:
+                        self._db.execute("INSERT INTO files (test_file, stage, updated) VALUES (?, ?, ?)",
+                                         (test_file, stage, time.time()))
+                    elif STAGE_ORDER.index(row[0]) < rank:
+                        self._db.execute("UPDATE files SET stage = ?, updated = ? WHERE test_file = ?",
+                                         (stage, time.time(), test_file))
+                self._db.execute("COMMIT")
+            except BaseException:
+                self._db.execute("ROLLBACK")
+                raise
+
+    def counts(self) -> Dict[str, int]:
+        """Files per stage"""
+        with self._lock:
+            rows = self._db.execute("SELECT stage, COUNT(*) FROM files GROUP BY stage").fetchall()
+        return dict(rows)
+
+    def step_done(self, name: str) -> bool:
+        with self._lock:
+            return self._db.execute("SELECT 1 FROM steps WHERE name = ?", (name,)).fetchone() is not None
+
+    def complete_step(self, name: str):
+        with self._lock:
+            self._db.execute("INSERT OR REPLACE INTO steps (name, completed) VALUES (?, ?)", (name, time.time()))
+
+    def close(self):
+        with self._lock:
+            self._db.close()
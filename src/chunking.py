@@ -0,0 +1,197 @@
+"""
+Large-file chunking
+Splits C++ sources at class and function boundaries into chunks that fit the
+token budget, and merges the test files generated per chunk back into one,
+deduplicating includes, fixtures and helpers
+"""
+
+import re
+import logging
+from dataclasses import dataclass
+from typing import Dict, List, Tuple
+
+from metrics import estimate_tokens
+from output_gate import strip_comments_and_literals
+from test_quality import TEST_HEADER_PATTERN
+from test_records import unique_name
+
+logger = logging.getLogger(__name__)
+
+NAMESPACE_PATTERN = re.compile(r'^\s*(?:inline\s+)?namespace\s*([\w:]*)\s*\{')
+CLASS_PATTERN = re.compile(r'^\s*(?:template\s*<[^{;]*>\s*)?(?:class|struct|union)\s+(?:\w+\s+)*?(\w+)\s*(?:final\s*)?[:{]')
+FUNCTION_NAME_PATTERN = re.compile(r'([~\w:]+)\s*\(')
+INCLUDE_PATTERN = re.compile(r'^\s*#\s*include\b')
+
+
+@dataclass
+class Chunk:
+    """A slice of a source file that is prompted on its own"""
+    label: str  # names of the classes and functions it contains
+    text: str  # shared preamble followed by the chunk's definitions
+
+
+def top_level_items(source: str) -> List[str]:
+    """Split source into top-level preprocessor lines, declarations and brace-delimited definitions"""
+    code = strip_comments_and_literals(source)
+    items = []
+    start = 0
+    depth = 0
+    index = 0
+    length = len(code)
+    while index < length:
+        char = code[index]
+        if depth == 0 and char == '#' and not code[start:index].strip():
+            # Preprocessor line, including backslash continuations
+            end = index
+            while True:
+                end = code.find('\n', end)
+                if end == -1:
+                    end = length
+                    break
+                if code[end - 1] != '\\':
+                    break
+                end += 1
+            items.append(source[start:end + 1])
+            start = index = end + 1
+            continue
+        if char == '{':
+            depth += 1
+        elif char == '}':
+            depth -= 1
+            if depth == 0:
+                end = index + 1
+                follow = re.match(r'\s*(?:\w+\s*)?;', code[end:])
+                head = code[start:code.index('{', start)]
+                # Classes, enums and initializers end at their ';', functions and namespaces at the brace
+                if follow and ('(' not in head or '=' in head or CLASS_PATTERN.match(code[start:end])):
+                    end += follow.end()
+                items.append(source[start:end])
+                start = index = end
+                continue
+        elif char == ';' and depth == 0:
+            items.append(source[start:index + 1])
+            start = index + 1
+        index += 1
+    tail = source[start:]
+    if tail.strip():
+        items.append(tail)
+    return [item for item in items if item.strip()]
+
+
+def classify(item: str) -> Tuple[str, str]:
+    """Return (kind, name) with kind one of preprocessor, namespace, test, class, function, declaration"""
+    code = strip_comments_and_literals(item).strip()
+    if code.startswith('#'):
+        return 'preprocessor', ''
+    match = TEST_HEADER_PATTERN.match(code)
+    if match:
+        return 'test', f"{match.group(2)}.{match.group(3)}"
+    match = NAMESPACE_PATTERN.match(code)
+    if match:
+        return 'namespace', match.group(1)
+    match = CLASS_PATTERN.match(code)
+    if match and code.rstrip().endswith(';') and '{' in code:
+        return 'class', match.group(1)
+    brace = code.find('{')
+    if brace != -1 and '(' in code[:brace]:
+        name = FUNCTION_NAME_PATTERN.search(code[:brace])
+        return 'function', name.group(1) if name else ''
+    return 'declaration', ''
+
+
+def _namespace_body(item: str) -> str:
+    return item[item.index('{') + 1:item.rindex('}')]
+
+
+def _wrap(text: str, namespaces: List[str]) -> str:
+    for name in reversed(namespaces):
+        text = f"namespace {name} {{\n{text.strip()}\n}}" if name else f"namespace {{\n{text.strip()}\n}}"
+    return text
+
+
+def split_source(source: str, max_tokens: int) -> List[Chunk]:
+    """Chunks of at most max_tokens (definitions larger than that travel alone); one chunk for small files"""
+    if estimate_tokens(source) <= max_tokens:
+        return [Chunk("", source)]
+
+    preamble: List[str] = []
+    units: List[Tuple[str, str]] = []
+
+    def collect(text: str, namespaces: List[str]):
+        for item in top_level_items(text):
+            kind, name = classify(item)
+            if kind == 'namespace':
+                collect(_namespace_body(item), namespaces + [name])
+            elif kind in ('class', 'function'):
+                units.append((name, _wrap(item, namespaces)))
+            else:
+                # Includes, using-declarations, forward declarations and constants are shared by every chunk
+                preamble.append(_wrap(item, namespaces) if namespaces else item.strip())
+
+    collect(source, [])
+    shared = "\n".join(preamble)
+    budget = max(1, max_tokens - estimate_tokens(shared))
+
+    chunks: List[Chunk] = []
+    names: List[str] = []
+    body: List[str] = []
+    size = 0
+    for name, text in units:
+        tokens = estimate_tokens(text)
+        if body and size + tokens > budget:
+            chunks.append(Chunk(", ".join(n for n in names if n), shared + "\n\n" + "\n\n".join(body)))
+            names, body, size = [], [], 0
+        if tokens > budget:
+            logger.warning(f"{name or 'definition'} alone exceeds the chunk budget ({tokens} > {budget} tokens)")
+        names.append(name)
+        body.append(text)
+        size += tokens
+    if body:
+        chunks.append(Chunk(", ".join(n for n in names if n), shared + "\n\n" + "\n\n".join(body)))
+    return chunks or [Chunk("", source)]
+
+
+def _normalized(text: str) -> str:
+    return re.sub(r'\s+', ' ', strip_comments_and_literals(text)).strip()
+
+
+def merge_test_files(parts: List[str]) -> str:
+    """Merge per-chunk test files: includes once, identical helpers once, clashing fixtures and tests renamed"""
+    includes: List[str] = []
+    helpers: List[str] = []
+    helper_keys = set()
+    tests: List[str] = []
+    classes: Dict[str, str] = {}
+    test_names = set()
+
+    for number, part in enumerate(parts, 1):
+        # A fixture redefined differently by another chunk is renamed throughout this part
+        for item in top_level_items(part):
+            kind, name = classify(item)
+            if kind == 'class' and name in classes and classes[name] != _normalized(item):
+                part = re.sub(rf'\b{re.escape(name)}\b', f"{name}{number}", part)
+        for item in top_level_items(part):
+            kind, name = classify(item)
+            text = item.strip()
+            if kind == 'preprocessor' and INCLUDE_PATTERN.match(text):
+                if text not in includes:
+                    includes.append(text)
+            elif kind == 'test':
+                suite, test = name.split('.')
+                renamed = unique_name(test, lambda name: f"{suite}.{name}" in test_names)
+                if renamed != test:
+                    text = re.sub(rf'(\(\s*{re.escape(suite)}\s*,\s*){re.escape(test)}(\s*\))',
+                                  rf'\g<1>{renamed}\g<2>', text, count=1)
+                test_names.add(f"{suite}.{renamed}")
+                tests.append(text)
+            else:
+                key = _normalized(text)
+                if key in helper_keys:
+                    continue
+                helper_keys.add(key)
+                if kind == 'class':
+                    classes.setdefault(name, key)
+                helpers.append(text)
+
+    sections = ["\n".join(includes)] + helpers + tests
+    return "\n\n".join(section for section in sections if section) + "\n"
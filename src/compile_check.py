@@ -0,0 +1,78 @@
+"""
+Fast compile check for a single generated test file
+Runs the compiler in -fsyntax-only mode so candidates can be screened in parallel
+without configuring or linking the whole test project
+"""
+
+import os
+import re
+import shutil
+import logging
+import subprocess
+import time
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Iterable, List, Optional
+
+logger = logging.getLogger(__name__)
+
+ERROR_LINE_PATTERN = re.compile(r':\d+:\d+: (?:fatal )?error: ')
+
+
+@dataclass
+class CompileResult:
+    """Outcome of one syntax-only compile"""
+    ok: bool
+    diagnostics: str
+    seconds: float
+
+    @property
+    def error_count(self) -> int:
+        return len(ERROR_LINE_PATTERN.findall(self.diagnostics))
+
+
+def find_compiler() -> Optional[str]:
+    """Honor $CXX, then fall back to the usual C++ compiler names"""
+    for candidate in (os.environ.get('CXX'), 'c++', 'g++', 'clang++'):
+        if candidate and shutil.which(candidate):
+            return shutil.which(candidate)
+    return None
+
+
+class SyntaxChecker:
+    """Compiles test sources with -fsyntax-only against the project's include dirs"""
+
+    def __init__(self, include_dirs: Iterable[Path], compiler: Optional[str] = None,
+                 std: str = "c++17", timeout: int = 120):
+        self.include_dirs = [Path(d) for d in include_dirs]
+        self.compiler = compiler or find_compiler()
+        self.std = std
+        self.timeout = timeout
+        if not self.compiler:
+            logger.warning("No C++ compiler found; compile checks are skipped")
+
+    @property
+    def available(self) -> bool:
+        return self.compiler is not None
+
+    def command(self) -> List[str]:
+        cmd = [self.compiler, f"-std={self.std}", "-fsyntax-only", "-x", "c++"]
+        for include_dir in self.include_dirs:
+            cmd.append(f"-I{include_dir}")
+        cmd.append("-")
+        return cmd
+
+    def check(self, content: str) -> CompileResult:
+        """Compile content from stdin; an unavailable compiler counts as a pass"""
+        if not self.available:
+            return CompileResult(True, "", 0.0)
+
+        start = time.perf_counter()
+        try:
+            result = subprocess.run(self.command(), input=content, capture_output=True,
+                                    text=True, timeout=self.timeout)
+            return CompileResult(result.returncode == 0, result.stderr, time.perf_counter() - start)
+        except subprocess.TimeoutExpired:
+            return CompileResult(False, "syntax check timed out", time.perf_counter() - start)
+        except OSError as e:
+            return CompileResult(False, str(e), time.perf_counter() - start)
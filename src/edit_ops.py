@@ -0,0 +1,137 @@
+"""
+Structured edits to generated test files
+Refinement and coverage stages answer with a JSON list of operations (add,
+replace or delete a test, fix includes) that is validated and applied locally,
+so the model never has to re-emit the unchanged part of a file
+"""
+
+import re
+import json
+from typing import Any, Dict, List, Optional, Tuple
+
+from test_quality import extract_test_blocks
+
+JSON_FENCE_PATTERN = re.compile(r'^```[ \t]*(?:json)?[ \t]*\n(.*?)^```[ \t]*$', re.MULTILINE | re.DOTALL)
+INCLUDE_LINE_PATTERN = re.compile(r'^[ \t]*#[ \t]*include[ \t]*([<"][^>"]+[>"])[^\n]*\n?', re.MULTILINE)
+INCLUDE_SPEC_PATTERN = re.compile(r'^(?:<[\w./+-]+>|"[\w./+-]+")$')
+
+EDIT_OPS = ('add_test', 'replace_test', 'delete_test', 'add_include', 'remove_include',
+            'replace_include', 'replace_text')
+
+
+def parse_edit_ops(text: str) -> Optional[List[Dict[str, Any]]]:
+    """Return the edit operations in a response, or None when it is not an edit list (e.g. a whole file)
+
+    Only a fenced JSON block or a response that is entirely JSON counts; brackets inside C++
+    (lambdas, subscripts) must not turn a whole-file answer into an edit list.
+    """
+    candidates = JSON_FENCE_PATTERN.findall(text) + [text.strip()]
+    for candidate in candidates:
+        try:
+            data = json.loads(candidate)
+        except ValueError:
+            continue
+        if isinstance(data, dict):
+            data = data.get('edits')
+        if isinstance(data, list) and all(isinstance(op, dict) and 'op' in op for op in data):
+            return data
+    return None
+
+
+def _include_spec(value: Any) -> Optional[str]:
+    """Normalize 'vector', '<vector>', '"Foo.h"' or '#include <vector>' to the bracketed form;
+    None for a missing, empty or malformed include"""
+    value = re.sub(r'^\s*#\s*include\s*', '', str(value or '')).strip()
+    if value[:1] not in ('<', '"'):
+        value = f'"{value}"' if re.search(r'\.(?:h|hh|hpp|hxx)$', value) else f'<{value}>'
+    return value if INCLUDE_SPEC_PATTERN.match(value) else None
+
+
+def _find_test(content: str, full_name: str):
+    """The test named Suite.Name; a bare test name is ambiguous when two suites share it"""
+    return next((block for block in extract_test_blocks(content) if block.full_name == full_name), None)
+
+
+def apply_edit_ops(content: str, ops: List[Dict[str, Any]]) -> Tuple[str, List[str]]:
+    """Apply operations in order; returns the new content and a list of operations that could not apply"""
+    problems = []
+    for index, op in enumerate(ops, 1):
+        kind = op.get('op')
+        label = f"edit {index} ({kind})"
+        if kind not in EDIT_OPS:
+            problems.append(f"{label}: unknown operation, expected one of {', '.join(EDIT_OPS)}")
+            continue
+
+        if kind in ('add_include', 'remove_include', 'replace_include'):
+            value = op.get('include') or op.get('old')
+            spec = _include_spec(value)
+            if spec is None:
+                problems.append(f"{label}: missing or invalid include {value!r}")
+                continue
+            present = [m for m in INCLUDE_LINE_PATTERN.finditer(content) if m.group(1) == spec]
+            if kind == 'add_include':
+                if not present:
+                    last = list(INCLUDE_LINE_PATTERN.finditer(content))
+                    at = last[-1].end() if last else 0
+                    content = content[:at] + f"#include {spec}\n" + content[at:]
+            elif not present:
+                problems.append(f"{label}: {spec} is not included")
+            elif kind == 'remove_include':
+                content = content[:present[0].start()] + content[present[0].end():]
+            elif _include_spec(op.get('new')) is None:
+                problems.append(f"{label}: missing or invalid new include {op.get('new')!r}")
+            else:
+                replacement = f"#include {_include_spec(op.get('new'))}\n"
+                content = content[:present[0].start()] + replacement + content[present[0].end():]
+            continue
+
+        if kind == 'replace_text':
+            old, new = op.get('old', ''), op.get('new', '')
+            count = content.count(old) if old else 0
+            if count != 1:
+                problems.append(f"{label}: text to replace found {count} times, it must be unique")
+            else:
+                content = content.replace(old, new)
+            continue
+
+        code = str(op.get('code', '')).strip()
+        name = op.get('name', '')
+        if kind in ('replace_test', 'delete_test'):
+            block = _find_test(content, name)
+            if block is None:
+                problems.append(f"{label}: no test named {name!r}; name tests as Suite.Name")
+            elif kind == 'delete_test':
+                content = content[:block.start] + content[block.end:]
+            elif not code:
+                problems.append(f"{label}: missing code")
+            else:
+                content = content[:block.start] + code + content[block.end:]
+            continue
+
+        # add_test
+        added = extract_test_blocks(code)
+        if not added:
+            problems.append(f"{label}: code contains no TEST/TEST_F/TEST_P")
+            continue
+        clashes = [block.full_name for block in added if _find_test(content, block.full_name)]
+        if clashes:
+            problems.append(f"{label}: {', '.join(clashes)} already exists; use replace_test")
+            continue
+        after = _find_test(content, op['after']) if op.get('after') else None
+        at = after.end if after else len(content.rstrip())
+        content = content[:at] + "\n\n" + code + "\n" + content[at:]
+
+    return re.sub(r'\n{3,}', '\n\n', content).rstrip() + "\n", problems
+
+
+# What a retry asks for when the stage expects edit operations; they apply to the original file again
+EDIT_LIST_ANSWER = "only a JSON list of edit operations on the current test file, not the complete file"
+
+
+def edit_retry_instructions(problems: List[str]) -> str:
+    """Prompt suffix naming the operations that could not be applied"""
+    return (
+        "\n\nSome of your edit operations could not be applied:\n"
+        + "\n".join(f"- {problem}" for problem in problems)
+        + "\nReturn the complete corrected JSON list of edit operations."
+    )
@@ -0,0 +1,177 @@
+"""
+Filesystem watching
+Recursive inotify watches through ctypes on Linux, mtime polling elsewhere;
+events are debounced into batches so one save (or a burst of them) triggers
+one regeneration
+"""
+
+import os
+import time
+import errno
+import ctypes
+import ctypes.util
+import select
+import struct
+import logging
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import Callable, Dict, Iterator, List, Set, Tuple
+
+logger = logging.getLogger(__name__)
+
+IN_CLOSE_WRITE = 0x00000008
+IN_MOVED_FROM = 0x00000040
+IN_MOVED_TO = 0x00000080
+IN_CREATE = 0x00000100
+IN_DELETE = 0x00000200
+IN_Q_OVERFLOW = 0x00004000
+IN_IGNORED = 0x00008000
+IN_ISDIR = 0x40000000
+IN_NONBLOCK = 0o4000
+IN_CLOEXEC = 0o2000000
+
+WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_CREATE | IN_DELETE
+EVENT_HEADER = struct.Struct('iIII')  # wd, mask, cookie, name length
+
+
+@dataclass
+class ChangeBatch:
+    """Paths changed during one debounce window"""
+    paths: Set[Path] = field(default_factory=set)
+    first_event: float = 0.0  # time.monotonic() of the first event, for save-to-result latency
+    rescan: bool = False  # events were lost (queue overflow); everything may have changed
+
+
+class _Inotify:
+    def __init__(self, root: Path, prune: Callable[[Path], bool]):
+        libc_name = ctypes.util.find_library('c')
+        self.libc = ctypes.CDLL(libc_name, use_errno=True)
+        self.fd = self.libc.inotify_init1(IN_NONBLOCK | IN_CLOEXEC)
+        if self.fd < 0:
+            raise OSError(ctypes.get_errno(), "inotify_init1 failed")
+        self.prune = prune
+        self.watches: Dict[int, Path] = {}
+        self.add_tree(root)
+
+    def add_tree(self, top: Path) -> List[Path]:
+        """Watch top and every directory below it that is not pruned; returns the files found"""
+        found = []
+        for directory, dirnames, filenames in os.walk(top):
+            dirnames[:] = [name for name in dirnames if not self.prune(Path(directory) / name)]
+            wd = self.libc.inotify_add_watch(self.fd, os.fsencode(directory), WATCH_MASK)
+            if wd < 0:
+                code = ctypes.get_errno()
+                if code == errno.ENOSPC:
+                    logger.warning("inotify watch limit reached; raise fs.inotify.max_user_watches")
+                    return found
+                continue
+            self.watches[wd] = Path(directory)
+            found.extend(Path(directory) / name for name in filenames)
+        return found
+
+    def read(self, timeout: float) -> Tuple[Set[Path], bool]:
+        ready, _, _ = select.select([self.fd], [], [], timeout)
+        if not ready:
+            return set(), False
+        try:
+            data = os.read(self.fd, 65536)
+        except BlockingIOError:
+            return set(), False
+        paths: Set[Path] = set()
+        overflow = False
+        offset = 0
+        while offset < len(data):
+            wd, mask, _, length = EVENT_HEADER.unpack_from(data, offset)
+            offset += EVENT_HEADER.size
+            name = data[offset:offset + length].rstrip(b'\0')
+            offset += length
+            if mask & IN_Q_OVERFLOW:
+                overflow = True
+                continue
+            if mask & IN_IGNORED:
+                self.watches.pop(wd, None)
+                continue
+            directory = self.watches.get(wd)
+            if directory is None or not name:
+                continue
+            path = directory / os.fsdecode(name)
+            if mask & IN_ISDIR:
+                # A new or moved-in directory brings its own files along
+                if mask & (IN_CREATE | IN_MOVED_TO) and not self.prune(path):
+                    paths.update(self.add_tree(path))
+                continue
+            paths.add(path)
+        return paths, overflow
+
+    def close(self):
+        os.close(self.fd)
+
+
+class _Poller:
+    """Fallback for platforms without inotify: compares mtimes and sizes every interval"""
+
+    def __init__(self, root: Path, prune: Callable[[Path], bool], interval: float = 0.5):
+        self.root = root
+        self.prune = prune
+        self.interval = interval
+        self.snapshot = self._snapshot()
+
+    def _snapshot(self) -> Dict[Path, Tuple[int, int]]:
+        snapshot = {}
+        for directory, dirnames, filenames in os.walk(self.root):
+            dirnames[:] = [name for name in dirnames if not self.prune(Path(directory) / name)]
+            for name in filenames:
+                path = Path(directory) / name
+                try:
+                    stat = path.stat()
+                except OSError:
+                    continue
+                snapshot[path] = (stat.st_mtime_ns, stat.st_size)
+        return snapshot
+
+    def read(self, timeout: float) -> Tuple[Set[Path], bool]:
+        time.sleep(min(timeout, self.interval))
+        current = self._snapshot()
+        changed = {path for path in current.keys() | self.snapshot.keys()
+                   if current.get(path) != self.snapshot.get(path)}
+        self.snapshot = current
+        return changed, False
+
+    def close(self):
+        pass
+
+
+class SourceWatcher:
+    """Yields debounced batches of changed files under a root"""
+
+    def __init__(self, root: Path, wanted: Callable[[Path], bool], prune: Callable[[Path], bool]):
+        self.wanted = wanted
+        try:
+            self.backend = _Inotify(Path(root), prune)
+            self.kind = "inotify"
+        except (OSError, AttributeError, TypeError) as e:
+            logger.info(f"inotify unavailable ({e}), polling for changes instead")
+            self.backend = _Poller(Path(root), prune)
+            self.kind = "polling"
+
+    def batches(self, debounce_s: float = 0.5) -> Iterator[ChangeBatch]:
+        """Block until something changes, then wait for debounce_s of quiet before yielding the batch"""
+        while True:
+            batch = ChangeBatch()
+            while not batch.paths and not batch.rescan:
+                paths, overflow = self.backend.read(1.0)
+                batch.paths = {path for path in paths if self.wanted(path)}
+                batch.rescan = overflow
+                batch.first_event = time.monotonic()
+            quiet_until = time.monotonic() + debounce_s
+            while time.monotonic() < quiet_until:
+                paths, overflow = self.backend.read(max(0.0, quiet_until - time.monotonic()))
+                paths = {path for path in paths if self.wanted(path)}
+                if paths or overflow:
+                    batch.paths |= paths
+                    batch.rescan |= overflow
+                    quiet_until = time.monotonic() + debounce_s
+            yield batch
+
+    def close(self):
+        self.backend.close()
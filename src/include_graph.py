@@ -0,0 +1,171 @@
+"""
+Include graph of the C++ project under test
+Used to schedule generation leaf-first and to find which tests a change invalidates
+"""
+
+import os
+import re
+import hashlib
+import logging
+from pathlib import Path
+from typing import Dict, Iterable, List, Optional, Set
+
+logger = logging.getLogger(__name__)
+
+# Only quoted includes can point into the project; <...> includes are system/third-party
+INCLUDE_PATTERN = re.compile(r'^\s*#\s*include\s*"([^"]+)"', re.MULTILINE)
+
+
+def file_digest(file_path: Path) -> str:
+    """Return a content hash used to detect changed sources"""
+    try:
+        return hashlib.sha256(file_path.read_bytes()).hexdigest()
+    except OSError:
+        return ""
+
+
+class IncludeGraph:
+    """Directed graph of project-local #include edges between C++ files"""
+
+    def __init__(self, project_path: Path, files: Iterable[Path]):
+        self.project_path = Path(project_path)
+        self.files: List[Path] = sorted({Path(f) for f in files})
+        self._file_set: Set[Path] = set(self.files)
+        self._by_name: Dict[str, List[Path]] = {}
+        self._canonical: Dict[str, Path] = {}
+        self._real_dirs: Dict[Path, str] = {}
+        for file_path in self.files:
+            self._by_name.setdefault(file_path.name, []).append(file_path)
+            self._canonical[self._resolved(file_path.parent, file_path.name)] = file_path
+
+        # includes[a] = files a includes, included_by[b] = files that include b
+        self.includes: Dict[Path, Set[Path]] = {f: set() for f in self.files}
+        self.included_by: Dict[Path, Set[Path]] = {f: set() for f in self.files}
+        self._build()
+
+    def _build(self):
+        """Parse every file once and record its project-local includes"""
+        for file_path in self.files:
+            try:
+                content = file_path.read_text(encoding='utf-8', errors='replace')
+            except OSError as e:
+                logger.warning(f"Could not read {file_path} for include scanning: {e}")
+                continue
+
+            for target in INCLUDE_PATTERN.findall(content):
+                resolved = self._resolve(file_path, target)
+                if resolved is None or resolved == file_path:
+                    continue
+                self.includes[file_path].add(resolved)
+                self.included_by[resolved].add(file_path)
+
+        edge_count = sum(len(deps) for deps in self.includes.values())
+        logger.info(f"Include graph: {len(self.files)} files, {edge_count} edges")
+
+    def _resolve(self, including_file: Path, target: str) -> Optional[Path]:
+        """Resolve an include the way the compiler would: relative dir first, then project root"""
+        for base in (including_file.parent, self.project_path):
+            candidate = self._canonical.get(self._resolved(base, target))
+            if candidate is not None:
+                return candidate
+
+        # Fall back to a unique basename match for projects built with extra -I dirs
+        matches = self._by_name.get(Path(target).name, [])
+        if len(matches) == 1:
+            return matches[0]
+        return None
+
+    def _resolved(self, base: Path, target: str) -> str:
+        """Canonical path of base/target; each directory is resolved once and the rest is
+        normalized lexically (resolving every include separately dominated graph construction)"""
+        real = self._real_dirs.get(base)
+        if real is None:
+            real = self._real_dirs[base] = str(base.resolve())
+        return os.path.normpath(os.path.join(real, target))
+
+    def dependencies(self, file_path: Path) -> Set[Path]:
+        """Return every file transitively included by file_path"""
+        return self._walk(file_path, self.includes)
+
+    def dependents(self, changed: Iterable[Path]) -> Set[Path]:
+        """Return the changed files plus every file that transitively includes one of them"""
+        affected: Set[Path] = set()
+        for file_path in changed:
+            file_path = Path(file_path)
+            if file_path not in self._file_set:
+                continue
+            affected.add(file_path)
+            affected |= self._walk(file_path, self.included_by)
+        return affected
+
+    @staticmethod
+    def _walk(start: Path, edges: Dict[Path, Set[Path]]) -> Set[Path]:
+        seen: Set[Path] = set()
+        stack = list(edges.get(start, ()))
+        while stack:
+            node = stack.pop()
+            if node in seen or node == start:
+                continue
+            seen.add(node)
+            stack.extend(edges.get(node, ()))
+        return seen
+
+    def generation_layers(self, targets: Optional[Iterable[Path]] = None) -> List[List[Path]]:
+        """
+        Group files into layers so each file comes after everything it includes.
+        Layer 0 holds leaf modules; files in or behind an include cycle share the last layer.
+        With targets, only their subgraph is layered: a target waits for the targets it reaches
+        through includes, however many untouched files lie in between.
+        """
+        if targets is None:
+            return self._layers(self.files, self.includes, self.included_by)
+        wanted = {Path(t) for t in targets} & self._file_set
+        if len(wanted) == len(self.files):
+            return self._layers(self.files, self.includes, self.included_by)
+
+        deps = {f: self._nearest(f, wanted) for f in wanted}
+        dependents: Dict[Path, Set[Path]] = {f: set() for f in wanted}
+        for f, reached in deps.items():
+            for dep in reached:
+                dependents[dep].add(f)
+        return self._layers(wanted, deps, dependents)
+
+    def _nearest(self, start: Path, wanted: Set[Path]) -> Set[Path]:
+        """Files in wanted that start includes directly or only through files outside wanted"""
+        found: Set[Path] = set()
+        seen = {start}
+        stack = list(self.includes[start])
+        while stack:
+            node = stack.pop()
+            if node in seen:
+                continue
+            seen.add(node)
+            if node in wanted:
+                found.add(node)
+            else:
+                stack.extend(self.includes[node])
+        return found
+
+    @staticmethod
+    def _layers(nodes: Iterable[Path], deps: Dict[Path, Set[Path]],
+                dependents: Dict[Path, Set[Path]]) -> List[List[Path]]:
+        """Kahn's algorithm, one layer per round: linear in files plus edges"""
+        waiting = {f: len(deps[f]) for f in nodes}
+        ready = sorted(f for f, count in waiting.items() if count == 0)
+        layers: List[List[Path]] = []
+        while ready:
+            layers.append(ready)
+            unblocked = []
+            for f in ready:
+                del waiting[f]
+                for dependent in dependents[f]:
+                    waiting[dependent] -= 1
+                    if waiting[dependent] == 0:
+                        unblocked.append(dependent)
+            ready = sorted(unblocked)
+
+        if waiting:
+            cycle = sorted(waiting)
+            logger.warning(f"Include cycle among {len(cycle)} files, scheduling them together")
+            layers.append(cycle)
+        return layers
@@ -0,0 +1,231 @@
+"""
+SQLite job queue
+Jobs are leased to worker processes for a limited time and kept alive by
+heartbeats; a lease that expires (the worker died) puts the job back in the
+queue until its attempts run out
+"""
+
+import os
+import json
+import time
+import socket
+import sqlite3
+import logging
+import threading
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Any, Dict, Iterable, List, Optional
+
+logger = logging.getLogger(__name__)
+
+QUEUE_NAME = ".job_queue.db"
+
+SCHEMA = """
+CREATE TABLE IF NOT EXISTS jobs (
+    id INTEGER PRIMARY KEY AUTOINCREMENT,
+    kind TEXT NOT NULL,
+    payload TEXT NOT NULL,
+    state TEXT NOT NULL DEFAULT 'queued',
+    attempts INTEGER NOT NULL DEFAULT 0,
+    worker TEXT,
+    lease_until REAL,
+    result TEXT,
+    error TEXT,
+    updated REAL NOT NULL
+);
+CREATE INDEX IF NOT EXISTS jobs_state ON jobs (state, id);
+CREATE TABLE IF NOT EXISTS workers (
+    name TEXT PRIMARY KEY,
+    pid INTEGER,
+    seen REAL NOT NULL,
+    jobs INTEGER NOT NULL DEFAULT 0,
+    metrics TEXT
+);
+CREATE TABLE IF NOT EXISTS meta (
+    key TEXT PRIMARY KEY,
+    value TEXT NOT NULL
+);
+"""
+
+
+@dataclass
+class Job:
+    id: int
+    kind: str
+    payload: Dict[str, Any]
+    attempts: int
+
+
+def worker_name() -> str:
+    return f"{socket.gethostname()}:{os.getpid()}"
+
+
+class JobQueue:
+    """Multi-process work queue with leases; each process opens its own, thread-safe, connection"""
+
+    def __init__(self, path: Path, lease_s: float = 60.0, max_attempts: int = 3):
+        self.path = Path(path)
+        self.lease_s = lease_s
+        self.max_attempts = max_attempts
+        self._lock = threading.RLock()
+        self._db = sqlite3.connect(str(self.path), timeout=30.0, isolation_level=None, check_same_thread=False)
+        self._db.execute("PRAGMA journal_mode=WAL")
+        self._db.execute("PRAGMA synchronous=NORMAL")
+        self._db.executescript(SCHEMA)
+
+    def _execute(self, sql: str, params: tuple = ()) -> sqlite3.Cursor:
+        with self._lock:
+            return self._db.execute(sql, params)
+
+    def _transaction(self, statements) -> Any:
+        """Run statements(db) inside BEGIN IMMEDIATE, so concurrent lessees serialize"""
+        with self._lock:
+            self._db.execute("BEGIN IMMEDIATE")
+            try:
+                value = statements(self._db)
+                self._db.execute("COMMIT")
+                return value
+            except BaseException:
+                self._db.execute("ROLLBACK")
+                raise
+
+    def reset(self):
+        """Drop all jobs, workers and settings before a new run"""
+        def clear(db):
+            for table in ("jobs", "workers", "meta"):
+                db.execute(f"DELETE FROM {table}")
+        self._transaction(clear)
+
+    def set_meta(self, key: str, value: Any):
+        self._execute("INSERT OR REPLACE INTO meta (key, value) VALUES (?, ?)", (key, json.dumps(value)))
+
+    def meta(self, key: str, default: Any = None) -> Any:
+        row = self._execute("SELECT value FROM meta WHERE key = ?", (key,)).fetchone()
+        return json.loads(row[0]) if row else default
+
+    def enqueue(self, kind: str, payloads: Iterable[Dict[str, Any]]) -> List[int]:
+        """Queue one job per payload; returns their ids"""
+        now = time.time()
+        return self._transaction(lambda db: [
+            db.execute("INSERT INTO jobs (kind, payload, updated) VALUES (?, ?, ?)",
+                       (kind, json.dumps(payload), now)).lastrowid
+            for payload in payloads
+        ])
+
+    def lease(self, worker: str) -> Optional[Job]:
+        """Take the oldest queued job, or one whose lease has expired"""
+        now = time.time()
+
+        def take(db):
+            # Expired leases whose attempts are used up are failed rather than handed out again
+            db.execute("UPDATE jobs SET state = 'failed', error = 'lease expired', updated = ? "
+                       "WHERE state = 'leased' AND lease_until < ? AND attempts >= ?", (now, now, self.max_attempts))
+            row = db.execute("SELECT id, kind, payload, attempts FROM jobs "
+                             "WHERE state = 'queued' OR (state = 'leased' AND lease_until < ?) ORDER BY id LIMIT 1",
+                             (now,)).fetchone()
+            if row is not None:
+                db.execute("UPDATE jobs SET state = 'leased', worker = ?, lease_until = ?, attempts = attempts + 1, "
+                           "updated = ? WHERE id = ?", (worker, now + self.lease_s, now, row[0]))
+            return row
+
+        row = self._transaction(take)
+        if row is None:
+            return None
+        return Job(row[0], row[1], json.loads(row[2]), row[3] + 1)
+
+    def heartbeat(self, job_id: int, worker: str) -> bool:
+        """Extend a lease; False if the job was taken over in the meantime"""
+        now = time.time()
+        cursor = self._execute("UPDATE jobs SET lease_until = ?, updated = ? "
+                               "WHERE id = ? AND worker = ? AND state = 'leased'",
+                               (now + self.lease_s, now, job_id, worker))
+        return cursor.rowcount == 1
+
+    def complete(self, job_id: int, worker: str, result: Any):
+        self._execute("UPDATE jobs SET state = 'done', result = ?, lease_until = NULL, updated = ? "
+                      "WHERE id = ? AND worker = ?", (json.dumps(result), time.time(), job_id, worker))
+
+    def fail(self, job_id: int, worker: str, error: str):
+        """Requeue the job, or fail it for good once it has used all its attempts"""
+        self._execute("UPDATE jobs SET state = CASE WHEN attempts >= ? THEN 'failed' ELSE 'queued' END, "
+                      "error = ?, lease_until = NULL, updated = ? WHERE id = ? AND worker = ?",
+                      (self.max_attempts, error, time.time(), job_id, worker))
+
+    def register(self, worker: str, jobs: int = 0, metrics: Optional[Dict[str, Any]] = None):
+        """Record that a worker process is alive, with its job count and cumulative metrics"""
+        self._execute("INSERT INTO workers (name, pid, seen, jobs, metrics) VALUES (?, ?, ?, ?, ?) "
+                      "ON CONFLICT(name) DO UPDATE SET seen = excluded.seen, jobs = excluded.jobs, "
+                      "metrics = COALESCE(excluded.metrics, metrics)",
+                      (worker, os.getpid(), time.time(), jobs, json.dumps(metrics) if metrics is not None else None))
+
+    def workers(self) -> Dict[str, int]:
+        """Jobs completed per registered worker process"""
+        return dict(self._execute("SELECT name, jobs FROM workers").fetchall())
+
+    def worker_metrics(self) -> List[Dict[str, Any]]:
+        rows = self._execute("SELECT metrics FROM workers WHERE metrics IS NOT NULL").fetchall()
+        return [json.loads(row[0]) for row in rows]
+
+    def finished(self, job_ids: List[int]) -> bool:
+        """True once every job of one enqueue call is done or failed"""
+        if not job_ids:
+            return True
+        # One enqueue call inserts contiguous ids, so a range query avoids SQLite's parameter limit
+        row = self._execute("SELECT COUNT(*) FROM jobs WHERE id BETWEEN ? AND ? AND state NOT IN ('done', 'failed')",
+                            (min(job_ids), max(job_ids))).fetchone()
+        return row[0] == 0
+
+    def results(self, job_ids: List[int]) -> Dict[int, Optional[Any]]:
+        """Result per job id; None for jobs that failed"""
+        if not job_ids:
+            return {}
+        wanted = set(job_ids)
+        rows = self._execute("SELECT id, state, result, error FROM jobs WHERE id BETWEEN ? AND ?",
+                             (min(job_ids), max(job_ids))).fetchall()
+        results = {}
+        for job_id, state, result, error in rows:
+            if job_id not in wanted:
+                continue
+            if state == 'failed':
+                logger.warning(f"Job {job_id} failed: {error}")
+            results[job_id] = json.loads(result) if state == 'done' and result else None
+        return results
+
+    def counts(self) -> Dict[str, int]:
+        return dict(self._execute("SELECT state, COUNT(*) FROM jobs GROUP BY state").fetchall())
+
+    def close(self):
+        with self._lock:
+            self._db.close()
+
+
+class Heartbeat:
+    """Background thread renewing the leases of the jobs a process is working on"""
+
+    def __init__(self, queue: JobQueue):
+        self.queue = queue
+        self._held: Dict[int, str] = {}
+        self._lock = threading.Lock()
+        self._stop = threading.Event()
+        self._thread = threading.Thread(target=self._run, daemon=True)
+        self._thread.start()
+
+    def _run(self):
+        while not self._stop.wait(self.queue.lease_s / 3):
+            with self._lock:
+                held = list(self._held.items())
+            for job_id, worker in held:
+                if not self.queue.heartbeat(job_id, worker):
+                    logger.warning(f"Lost the lease on job {job_id}")
+
+    def hold(self, job_id: int, worker: str):
+        with self._lock:
+            self._held[job_id] = worker
+
+    def release(self, job_id: int):
+        with self._lock:
+            self._held.pop(job_id, None)
+
+    def stop(self):
+        self._stop.set()
+        self._thread.join()
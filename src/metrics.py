@@ -0,0 +1,111 @@
+"""
+Pipeline metrics
+Thread-safe counters for every model call, aggregated per stage for the report
+"""
+
+import json
+import threading
+from collections import defaultdict
+from dataclasses import dataclass, field, asdict
+from pathlib import Path
+from typing import Any, Dict, Optional
+
+
+def estimate_tokens(text: str) -> int:
+    """Rough token count (~4 characters per token) used when providers report no usage"""
+    return max(1, len(text) // 4) if text else 0
+
+
+@dataclass
+class StageStats:
+    """Aggregated model usage for one pipeline stage"""
+    calls: int = 0
+    failures: int = 0
+    latency_s: float = 0.0
+    max_latency_s: float = 0.0
+    prompt_tokens: int = 0
+    completion_tokens: int = 0
+    cost_usd: float = 0.0
+    models: Dict[str, int] = field(default_factory=dict)
+
+    @property
+    def mean_latency_s(self) -> float:
+        return self.latency_s / self.calls if self.calls else 0.0
+
+
+class PipelineMetrics:
+    """Collects per-stage latency, token and cost figures plus free-form counters"""
+
+    def __init__(self, cost_per_1k_tokens: Optional[Dict[str, float]] = None):
+        self._lock = threading.Lock()
+        self.stages: Dict[str, StageStats] = defaultdict(StageStats)
+        self.counters: Dict[str, float] = defaultdict(float)
+        self.cost_per_1k_tokens = cost_per_1k_tokens or {}
+
+    def record_call(self, stage: str, provider: str, model: str, latency_s: float,
+                    prompt_tokens: int, completion_tokens: int, ok: bool = True):
+        """Record one provider call"""
+        rate = self.cost_per_1k_tokens.get(model, self.cost_per_1k_tokens.get(provider, 0.0))
+        with self._lock:
+            stats = self.stages[stage]
+            stats.calls += 1
+            stats.failures += 0 if ok else 1
+            stats.latency_s += latency_s
+            stats.max_latency_s = max(stats.max_latency_s, latency_s)
+            stats.prompt_tokens += prompt_tokens
+            stats.completion_tokens += completion_tokens
+            stats.cost_usd += (prompt_tokens + completion_tokens) / 1000.0 * rate
+            key = f"{provider}:{model}"
+            stats.models[key] = stats.models.get(key, 0) + 1
+
+    def increment(self, name: str, amount: float = 1):
+        """Bump a named counter"""
+        with self._lock:
+            self.counters[name] += amount
+
+    def merge(self, data: Dict[str, Any]):
+        """Add a to_dict() snapshot taken in another process"""
+        with self._lock:
+            for name, values in data.get("stages", {}).items():
+                stats = self.stages[name]
+                stats.calls += values.get("calls", 0)
+                stats.failures += values.get("failures", 0)
+                stats.latency_s += values.get("latency_s", 0.0)
+                stats.max_latency_s = max(stats.max_latency_s, values.get("max_latency_s", 0.0))
+                stats.prompt_tokens += values.get("prompt_tokens", 0)
+                stats.completion_tokens += values.get("completion_tokens", 0)
+                stats.cost_usd += values.get("cost_usd", 0.0)
+                for key, count in values.get("models", {}).items():
+                    stats.models[key] = stats.models.get(key, 0) + count
+            for name, value in data.get("counters", {}).items():
+                self.counters[name] += value
+
+    def to_dict(self) -> Dict[str, Any]:
+        with self._lock:
+            return {
+                "stages": {name: dict(asdict(stats), mean_latency_s=stats.mean_latency_s)
+                           for name, stats in self.stages.items()},
+                "counters": dict(self.counters),
+            }
+
+    def write_json(self, path: Path):
+        Path(path).write_text(json.dumps(self.to_dict(), indent=2, sort_keys=True), encoding='utf-8')
+
+    def render_markdown(self) -> str:
+        """Per-stage table for the generation report"""
+        data = self.to_dict()
+        lines = [
+            "| Stage | Calls | Failures | Mean latency (s) | Max latency (s) | Prompt tokens | Output tokens | Cost (USD) | Models |",
+            "|-------|-------|----------|------------------|-----------------|---------------|---------------|------------|--------|",
+        ]
+        for name, stats in sorted(data["stages"].items()):
+            models = ", ".join(f"{model} x{count}" for model, count in sorted(stats["models"].items()))
+            lines.append(
+                f"| {name} | {stats['calls']} | {stats['failures']} | {stats['mean_latency_s']:.2f} "
+                f"| {stats['max_latency_s']:.2f} | {stats['prompt_tokens']} | {stats['completion_tokens']} "
+                f"| {stats['cost_usd']:.4f} | {models} |"
+            )
+        if data["counters"]:
+            lines.append("")
+            lines.extend(f"- **{name}**: {value:g}" for name, value in sorted(data["counters"].items()))
+        return "\n".join(lines)
@@ -0,0 +1,312 @@
+"""
+Deterministic Google Mock generator
+Emits MOCK_METHOD classes for the project's virtual interfaces and common Drogon
+collaborators into one shared header, so the LLM never has to write them
+"""
+
+import re
+import logging
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import Iterable, Iterator, List, Optional, Tuple
+
+logger = logging.getLogger(__name__)
+
+MOCKS_HEADER_NAME = "generated_mocks.h"
+
+# (header, qualified class, mock name) for Drogon types tests most often hand-roll
+DROGON_COLLABORATORS = [
+    ("drogon/HttpRequest.h", "drogon::HttpRequest", "MockHttpRequest"),
+    ("drogon/HttpResponse.h", "drogon::HttpResponse", "MockHttpResponse"),
+    ("drogon/orm/DbClient.h", "drogon::orm::DbClient", "MockDbClient"),
+]
+
+DEFAULT_SYSTEM_INCLUDE_DIRS = ["/usr/local/include", "/usr/include"]
+
+COMMENT_PATTERN = re.compile(r'//[^\n]*|/\*.*?\*/', re.DOTALL)
+SCOPE_PATTERN = re.compile(
+    r'\bnamespace\s+([\w:]*)\s*\{'
+    r'|\b(?:class|struct)\s+(?:\w+\s+)*?(\w+)\s*(final\b)?\s*(?::[^;{]*)?\{'
+    r'|[{}]'
+)
+METHOD_PATTERN = re.compile(
+    r'^virtual\s+(?P<ret>.+?)\s*\b(?P<name>\w+)\s*\((?P<args>.*)\)\s*(?P<quals>[^()]*?)\s*(?:=\s*0)?\s*$',
+    re.DOTALL
+)
+
+
+@dataclass
+class MockMethod:
+    """One virtual method signature in MOCK_METHOD form"""
+    return_type: str
+    name: str
+    args: List[str]
+    qualifiers: List[str]
+
+    def render(self) -> str:
+        args = ", ".join(_protect_commas(arg) for arg in self.args)
+        quals = ", ".join(self.qualifiers + ["override"])
+        return f"    MOCK_METHOD({_protect_commas(self.return_type)}, {self.name}, ({args}), ({quals}));"
+
+
+@dataclass
+class MockClass:
+    """A mock for one interface"""
+    mock_name: str
+    base_name: str
+    header: str
+    methods: List[MockMethod] = field(default_factory=list)
+    inherit_constructors: bool = False  # the base declares constructors with parameters
+
+    def render(self) -> str:
+        # Declared in the base's namespace, where its signatures' unqualified types resolve
+        namespace, _, base = self.base_name.rpartition('::')
+        lines = [f"class {self.mock_name} : public {base} {{", "public:"]
+        if self.inherit_constructors:
+            lines.append(f"    using {base}::{base};")
+        lines.extend(method.render() for method in self.methods)
+        lines.append("};")
+        if namespace:
+            lines = [f"namespace {namespace} {{"] + lines + [f"}}  // namespace {namespace}",
+                                                            f"using {namespace}::{self.mock_name};"]
+        return "\n".join(lines)
+
+    def summary(self) -> str:
+        names = ", ".join(dict.fromkeys(method.name for method in self.methods))
+        return f"{self.mock_name} : public {self.base_name} (mocks: {names})"
+
+
+def _protect_commas(text: str) -> str:
+    """MOCK_METHOD needs types with commas outside parentheses wrapped, since the preprocessor ignores <>"""
+    depth = 0
+    for char in text:
+        if char == '(':
+            depth += 1
+        elif char == ')':
+            depth -= 1
+        elif char == ',' and depth == 0:
+            return f"({text})"
+    return text
+
+
+def _split_top_level(text: str, separator: str) -> List[str]:
+    """Split on separator outside of <>, () and {} nesting"""
+    parts, depth, current = [], 0, []
+    for char in text:
+        if char in '<({[':
+            depth += 1
+        elif char in '>)}]':
+            depth -= 1
+        if char == separator and depth == 0:
+            parts.append("".join(current).strip())
+            current = []
+        else:
+            current.append(char)
+    tail = "".join(current).strip()
+    if tail or parts:
+        parts.append(tail)
+    return parts
+
+
+def _strip_default(arg: str) -> str:
+    """Drop a default argument value, which MOCK_METHOD does not accept"""
+    parts = _split_top_level(arg, '=')
+    return parts[0] if parts else arg
+
+
+def _matching_brace(text: str, open_index: int) -> int:
+    depth = 0
+    for index in range(open_index, len(text)):
+        if text[index] == '{':
+            depth += 1
+        elif text[index] == '}':
+            depth -= 1
+            if depth == 0:
+                return index
+    return len(text) - 1
+
+
+def _member_declarations(body: str) -> List[str]:
+    """Split a class body into top-level member declarations, skipping inline bodies"""
+    statements, current, depth = [], [], 0
+    for char in body:
+        if char == '{':
+            depth += 1
+            continue
+        if char == '}':
+            depth -= 1
+            if depth == 0:
+                statements.append("".join(current))
+                current = []
+            continue
+        if depth:
+            continue
+        if char == ';':
+            statements.append("".join(current))
+            current = []
+        else:
+            current.append(char)
+    return [re.sub(r'^\s*(?:(?:public|protected|private)\s*:\s*)+', '', s).strip() for s in statements]
+
+
+def parse_method(declaration: str) -> Optional[MockMethod]:
+    """Parse a 'virtual R name(args) quals [= 0]' declaration"""
+    declaration = " ".join(declaration.split())
+    match = METHOD_PATTERN.match(declaration)
+    # Destructors, operators and final overrides cannot be mocked
+    if (not match or '~' in declaration or match.group('name').startswith('operator')
+            or re.search(r'\bfinal\b', match.group('quals'))):
+        return None
+
+    return_type = re.sub(r'\b(?:inline|static)\s+', '', match.group('ret')).strip()
+    quals_text = match.group('quals')
+    qualifiers = []
+    if re.search(r'\bconst\b', quals_text):
+        qualifiers.append('const')
+    if re.search(r'\bnoexcept\b', quals_text):
+        qualifiers.append('noexcept')
+    ref = re.search(r'&&|&', quals_text)
+    if ref:
+        qualifiers.append(f"ref({ref.group(0)})")
+
+    args = [_strip_default(arg) for arg in _split_top_level(match.group('args'), ',')]
+    if args == ['void']:
+        args = []
+    return MockMethod(return_type, match.group('name'), args, qualifiers)
+
+
+def iter_namespace_classes(source: str) -> Iterator[Tuple[str, str]]:
+    """Yield (qualified name, body) for every namespace-level, non-template, non-final class"""
+    source = COMMENT_PATTERN.sub('', source)
+    scope: List[Optional[str]] = []  # namespace names; None for any other brace
+
+    for match in SCOPE_PATTERN.finditer(source):
+        token = match.group(0)
+        if token == '}':
+            if scope:
+                scope.pop()
+            continue
+        if token == '{':
+            scope.append(None)
+            continue
+        if match.group(1) is not None or token.startswith('namespace'):
+            scope.append(match.group(1) or None)
+            continue
+
+        class_name, is_final = match.group(2), match.group(3)
+        is_template = re.search(r'template\s*<[^;{}]*>\s*$', source[:match.start()]) is not None
+        if not is_final and not is_template and all(name is not None for name in scope):
+            open_index = match.end() - 1
+            body = source[open_index + 1:_matching_brace(source, open_index)]
+            yield "::".join([name for name in scope if name] + [class_name]), body
+        scope.append(None)
+
+
+def declares_constructor_with_args(class_name: str, declarations: List[str]) -> bool:
+    """True if any constructor takes parameters; such a class may have no default constructor to
+    build its mock with, so the mock inherits the constructors instead"""
+    pattern = re.compile(rf'^(?:(?:explicit|constexpr|inline)\s+)*{re.escape(class_name)}\s*\((.*?)\)', re.DOTALL)
+    for declaration in declarations:
+        match = pattern.match(declaration)
+        if match and match.group(1).strip() not in ('', 'void'):
+            return True
+    return False
+
+
+def parse_virtual_classes(source: str) -> List[Tuple[str, List[MockMethod], bool]]:
+    """Return (qualified class name, virtual methods, declares constructors with parameters) for every
+    mockable class with virtuals"""
+    classes = []
+    for qualified, body in iter_namespace_classes(source):
+        declarations = _member_declarations(body)
+        methods = [m for m in map(parse_method, declarations) if m is not None]
+        if methods:
+            classes.append((qualified, methods,
+                            declares_constructor_with_args(qualified.split('::')[-1], declarations)))
+    return classes
+
+
+class MockGenerator:
+    """Builds the shared mocks header from project headers and Drogon collaborators"""
+
+    def __init__(self, project_path: Path, include_dirs: Optional[Iterable[str]] = None):
+        self.project_path = Path(project_path)
+        self.include_dirs = [Path(d) for d in (include_dirs or DEFAULT_SYSTEM_INCLUDE_DIRS)]
+
+    def collect(self, headers: Iterable[Path], uses_drogon: bool = False) -> List[MockClass]:
+        """Collect mocks for every virtual interface declared in the given headers"""
+        mocks: List[MockClass] = []
+        taken = set()
+
+        for header in sorted(headers):
+            try:
+                source = header.read_text(encoding='utf-8', errors='replace')
+            except OSError as e:
+                logger.warning(f"Skipping {header} for mock generation: {e}")
+                continue
+            try:
+                include = header.relative_to(self.project_path).as_posix()
+            except ValueError:
+                include = header.name
+            for qualified, methods, with_args in parse_virtual_classes(source):
+                mock_name = self._unique_name(f"Mock{qualified.split('::')[-1]}", qualified, taken)
+                mocks.append(MockClass(mock_name, qualified, f'"{include}"', methods, with_args))
+
+        if uses_drogon:
+            mocks.extend(self._drogon_mocks(taken))
+        return mocks
+
+    def _drogon_mocks(self, taken: set) -> List[MockClass]:
+        mocks = []
+        for header, qualified, mock_name in DROGON_COLLABORATORS:
+            header_path = next((d / header for d in self.include_dirs if (d / header).is_file()), None)
+            if header_path is None:
+                logger.info(f"{header} not found in mock include dirs, skipping {mock_name}")
+                continue
+            source = header_path.read_text(encoding='utf-8', errors='replace')
+            found = next((found for found in parse_virtual_classes(source) if found[0] == qualified), None)
+            if found:
+                mocks.append(MockClass(self._unique_name(mock_name, qualified, taken), qualified,
+                                       f"<{header}>", found[1], found[2]))
+        return mocks
+
+    @staticmethod
+    def _unique_name(name: str, qualified: str, taken: set) -> str:
+        """MockFoo, else Mock<ns>_Foo, else the latter with a number until it is free"""
+        if name in taken:
+            base = name = "Mock" + qualified.replace("::", "_")
+            number = 1
+            while name in taken:
+                number += 1
+                name = f"{base}{number}"
+        taken.add(name)
+        return name
+
+    @staticmethod
+    def render(mocks: List[MockClass], uses_drogon: bool = False) -> str:
+        """Render the shared header"""
+        includes = ["<gmock/gmock.h>"] + sorted({mock.header for mock in mocks})
+        if uses_drogon:
+            includes.append("<drogon/HttpResponse.h>")
+        lines = [
+            "// Generated by test_generator.py from project headers. Do not edit; regenerated each run.",
+            "#pragma once",
+            "",
+        ]
+        lines.extend(f"#include {include}" for include in dict.fromkeys(includes))
+        lines.append("")
+        if uses_drogon:
+            lines.append("// Mock for the response callback passed to Drogon handlers")
+            lines.append("using MockResponseCallback = ::testing::MockFunction<void(const drogon::HttpResponsePtr &)>;")
+            lines.append("")
+        for mock in mocks:
+            lines.append(mock.render())
+            lines.append("")
+        return "\n".join(lines)
+
+    def write(self, headers: Iterable[Path], output_path: Path, uses_drogon: bool = False) -> List[MockClass]:
+        """Generate the shared header and return the mocks it declares"""
+        mocks = self.collect(headers, uses_drogon)
+        output_path.write_text(self.render(mocks, uses_drogon), encoding='utf-8')
+        logger.info(f"Generated {len(mocks)} shared mocks in {output_path}")
+        return mocks
@@ -0,0 +1,163 @@
+"""
+Per-stage model routing
+Honors model_name/temperature/max_tokens from each stage's YAML, and picks a
+smaller or larger model by prompt size and observed latency
+"""
+
+import os
+import logging
+import threading
+import requests
+from dataclasses import dataclass, replace
+from typing import Any, Callable, Dict, Optional
+
+logger = logging.getLogger(__name__)
+
+# Environment variables consulted when a stage routes to a provider other than the CLI one
+PROVIDER_KEY_ENV = {
+    'gemini': 'GEMINI_API_KEY',
+    'github': 'GITHUB_TOKEN',
+}
+
+LOCAL_MODEL_PREFIXES = ('llama', 'codellama', 'qwen', 'deepseek', 'mistral', 'phi', 'gemma', 'starcoder')
+GITHUB_MODEL_PREFIXES = ('gpt-', 'o1', 'o3', 'o4', 'openai/', 'meta/', 'microsoft/', 'mistral-ai/', 'deepseek/')
+
+# Where a stage routed to Ollama is sent when the CLI provider is a different one
+OLLAMA_TAGS_URL = "http://localhost:11434/api/tags"
+
+LATENCY_SMOOTHING = 0.3  # weight of the newest sample in the per-model latency average
+
+
+def infer_provider(model_name: str) -> Optional[str]:
+    """Guess which provider serves a model from its name"""
+    name = model_name.lower()
+    if name.startswith('gemini'):
+        return 'gemini'
+    if name.startswith(GITHUB_MODEL_PREFIXES):
+        return 'github'
+    if ':' in name or name.startswith(LOCAL_MODEL_PREFIXES):
+        return 'ollama'
+    return None
+
+
+@dataclass(frozen=True)
+class Route:
+    """Where one model call goes"""
+    stage: str
+    provider: str
+    model_name: str
+    temperature: float
+    max_tokens: int
+    reason: str  # stage, small, large, latency, fallback or cli
+
+
+class ModelRouter:
+    """Chooses provider, model and sampling settings for each stage's calls"""
+
+    def __init__(self, base_config, stage_configs: Dict[str, Dict[str, Any]],
+                 provider_factory: Callable[[Any], Any], enabled: bool = True):
+        self.base_config = base_config
+        self.stage_configs = stage_configs
+        self.provider_factory = provider_factory
+        self.enabled = enabled
+        self._providers: Dict[Route, Any] = {}
+        self._latency: Dict[str, float] = {}
+        self._reachable: Dict[str, bool] = {}  # provider -> answered the one probe
+        self._lock = threading.Lock()
+        # Settings given explicitly on the command line win over the stage YAML
+        self.pinned = set(getattr(base_config, 'cli_settings', None) or ())
+
+    def route(self, stage: str, prompt_tokens: Optional[int] = None) -> Route:
+        """Pick the model for a call of the given stage and prompt size; no size means the stage's own model"""
+        base = self.base_config
+        if not self.enabled:
+            return Route(stage, base.model_provider, base.model_name, base.temperature, base.max_tokens, 'cli')
+
+        stage_config = self.stage_configs.get(stage) or {}
+        routing = stage_config.get('routing') or {}
+        if 'model_name' in self.pinned:
+            stage_config = {key: value for key, value in stage_config.items() if key not in ('model_name', 'provider')}
+            routing = {}
+        model_name = stage_config.get('model_name') or base.model_name
+        reason = 'stage'
+
+        sized = prompt_tokens is not None
+        large_model = routing.get('large_model')
+        small_model = routing.get('small_model')
+        if sized and large_model and prompt_tokens >= routing.get('large_prompt_tokens', 3000):
+            budget = routing.get('latency_budget_s')
+            observed = self._latency.get(large_model)
+            if budget is not None and observed is not None and observed > budget:
+                reason = 'latency'
+            else:
+                model_name, reason = large_model, 'large'
+        elif sized and small_model and prompt_tokens <= routing.get('small_prompt_tokens', 800):
+            model_name, reason = small_model, 'small'
+
+        provider = stage_config.get('provider') if reason == 'stage' else None
+        provider = provider or infer_provider(model_name) or base.model_provider
+        temperature = base.temperature if 'temperature' in self.pinned else \
+            stage_config.get('temperature', base.temperature)
+        max_tokens = base.max_tokens if 'max_tokens' in self.pinned else stage_config.get('max_tokens', base.max_tokens)
+
+        if not self._available(provider):
+            logger.debug(f"{stage}: {provider} not configured, falling back to {base.model_provider}")
+            provider, model_name, reason = base.model_provider, base.model_name, 'fallback'
+
+        return Route(stage, provider, model_name, float(temperature), int(max_tokens), reason)
+
+    def _available(self, provider: str) -> bool:
+        if provider == self.base_config.model_provider:
+            return True
+        if provider == 'ollama':
+            return self._ollama_reachable()
+        return bool(os.environ.get(PROVIDER_KEY_ENV.get(provider, ''), ''))
+
+    def _ollama_reachable(self) -> bool:
+        """Probe the local Ollama server once, so an absent one does not cost a failed request per call"""
+        with self._lock:
+            if 'ollama' not in self._reachable:
+                try:
+                    requests.get(OLLAMA_TAGS_URL, timeout=1.0).raise_for_status()
+                    self._reachable['ollama'] = True
+                except requests.RequestException as e:
+                    logger.info(f"Ollama is not reachable ({e}); stages routed to it use the CLI provider")
+                    self._reachable['ollama'] = False
+            return self._reachable['ollama']
+
+    def provider_for(self, route: Route):
+        """Return a provider for the route, or None when the CLI default provider should serve it"""
+        base = self.base_config
+        if not self.enabled or route.reason == 'cli':
+            return None
+        if (route.provider, route.model_name, route.temperature, route.max_tokens) == \
+                (base.model_provider, base.model_name, base.temperature, base.max_tokens):
+            return None
+
+        key = replace(route, stage='', reason='')
+        with self._lock:
+            if key not in self._providers:
+                config = self.provider_config(route.provider, route.model_name,
+                                              temperature=route.temperature, max_tokens=route.max_tokens)
+                self._providers[key] = self.provider_factory(config)
+            return self._providers[key]
+
+    def provider_config(self, provider: str, model_name: str, **overrides):
+        """Derive a provider configuration from the CLI one, with credentials for the target provider"""
+        base = self.base_config
+        same_provider = provider == base.model_provider
+        return replace(
+            base,
+            model_provider=provider,
+            model_name=model_name,
+            api_key=base.api_key if same_provider else os.environ.get(PROVIDER_KEY_ENV.get(provider, '')),
+            api_url=base.api_url if same_provider else None,
+            **overrides
+        )
+
+    def observe_model(self, model_name: str, latency_s: float):
+        """Feed a measured latency back into the per-model average"""
+        with self._lock:
+            previous = self._latency.get(model_name)
+            self._latency[model_name] = latency_s if previous is None else \
+                LATENCY_SMOOTHING * latency_s + (1 - LATENCY_SMOOTHING) * previous
@@ -0,0 +1,155 @@
+"""
+Local gate for model output
+Strips markdown fences and prose from generated test files and rejects output
+that can never compile before any compiler is invoked
+"""
+
+import re
+import logging
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import Iterable, List, Tuple
+
+logger = logging.getLogger(__name__)
+
+QUARANTINE_DIR = "quarantine"
+
+# What a retry asks for when the stage expects a whole test file back
+WHOLE_FILE_ANSWER = "only the complete C++ test file, with no markdown fences and no explanations"
+
+FENCE_PATTERN = re.compile(r'^```[ \t]*([\w+#-]*)[ \t]*\n(.*?)^```[ \t]*$', re.MULTILINE | re.DOTALL)
+CODE_LINE_PATTERN = re.compile(
+    r'^\s*(?:#\s*(?:include|define|if|pragma)|//|/\*|using\b|namespace\b|class\b|struct\b|template\b'
+    r'|TEST(?:_F|_P)?\s*\(|static\b|const\b|void\b|int\b|auto\b|enum\b|typedef\b)'
+)
+TEST_MACRO_PATTERN = re.compile(r'\b(TEST|TEST_F|TEST_P)\s*\(\s*(\w+)\s*,\s*(\w+)\s*\)')
+GTEST_INCLUDE_PATTERN = re.compile(r'#\s*include\s*[<"](?:gtest/gtest\.h|gmock/gmock\.h)[>"]')
+LITERAL_PATTERN = re.compile(
+    r'//[^\n]*'
+    r'|/\*.*?\*/'
+    r'|R"([^()\\ ]{0,16})\(.*?\)\1"'
+    r'|"(?:\\.|[^"\\\n])*"'
+    r"|'(?:\\.|[^'\\\n])*'",
+    re.DOTALL
+)
+
+
+def strip_comments_and_literals(code: str) -> str:
+    """Blank out comments and string/char literals so braces and names inside them are ignored
+
+    Offsets are preserved, so positions found in the result index the original text.
+    """
+    def blank(match: re.Match) -> str:
+        text = match.group(0)
+        if text.startswith('//') or text.startswith('/*'):
+            return re.sub(r'[^\n]', ' ', text)
+        return text[0] + re.sub(r'[^\n]', ' ', text[1:-1]) + text[-1]
+    return LITERAL_PATTERN.sub(blank, code)
+
+
+def sanitize(text: str) -> str:
+    """Extract the C++ payload from a model response"""
+    blocks = FENCE_PATTERN.findall(text)
+    if blocks:
+        cpp_blocks = [body for lang, body in blocks if lang.lower() in ('cpp', 'c++', 'cc', 'cxx', 'c', '')]
+        # Pick the largest code block; responses often add a short usage snippet after the file
+        text = max(cpp_blocks or [body for _, body in blocks], key=len)
+    else:
+        # Unterminated or missing fences: drop stray fence lines and surrounding prose
+        text = "\n".join(line for line in text.splitlines() if not line.strip().startswith('```'))
+
+    lines = text.splitlines()
+    start = next((i for i, line in enumerate(lines) if CODE_LINE_PATTERN.match(line)), 0)
+    end = len(lines)
+    while end > start and not lines[end - 1].strip():
+        end -= 1
+    # Trailing prose after the last closing brace is never part of the file
+    last_brace = max((i for i in range(start, end) if lines[i].strip().startswith('}')), default=None)
+    if last_brace is not None:
+        tail = lines[last_brace + 1:end]
+        if tail and not any(CODE_LINE_PATTERN.match(line) or line.strip().endswith(';') for line in tail):
+            end = last_brace + 1
+
+    return "\n".join(lines[start:end]).strip() + "\n"
+
+
+@dataclass
+class GateResult:
+    """Outcome of validating one generated test file"""
+    content: str
+    problems: List[str] = field(default_factory=list)
+    test_names: List[Tuple[str, str]] = field(default_factory=list)
+
+    @property
+    def ok(self) -> bool:
+        return not self.problems
+
+
+def validate(content: str, reserved_names: Iterable[str] = ()) -> GateResult:
+    """Check the cheap structural properties every compilable gtest file has"""
+    code = strip_comments_and_literals(content)
+    result = GateResult(content)
+
+    depth = 0
+    for char in code:
+        if char == '{':
+            depth += 1
+        elif char == '}':
+            depth -= 1
+            if depth < 0:
+                break
+    if depth != 0:
+        result.problems.append(f"unbalanced braces (net {depth:+d})")
+
+    if code.count('(') != code.count(')'):
+        result.problems.append("unbalanced parentheses")
+
+    if not GTEST_INCLUDE_PATTERN.search(content):
+        result.problems.append("missing #include <gtest/gtest.h>")
+
+    result.test_names = [(suite, name) for _, suite, name in TEST_MACRO_PATTERN.findall(code)]
+    if not result.test_names:
+        result.problems.append("no TEST/TEST_F/TEST_P macros")
+
+    seen = set()
+    duplicates = []
+    for test_name in result.test_names:
+        if test_name in seen and test_name not in duplicates:
+            duplicates.append(test_name)
+        seen.add(test_name)
+    if duplicates:
+        result.problems.append("duplicate test names: " + ", ".join(f"{s}.{n}" for s, n in duplicates))
+
+    for name in reserved_names:
+        escaped = re.escape(name)
+        if re.search(rf'^\s*(?:class|struct)\s+{escaped}\b[^;]*\{{', code, re.MULTILINE):
+            result.problems.append(f"redefines shared class {name}")
+        elif re.search(rf'^[\w:<>,\s*&]*\b{escaped}\s*\([^;{{]*\)\s*(?:const\s*)?\{{', code, re.MULTILINE):
+            result.problems.append(f"redefines shared helper {name}()")
+
+    return result
+
+
+def gate(raw_output: str, reserved_names: Iterable[str] = ()) -> GateResult:
+    """Sanitize then validate a raw model response"""
+    return validate(sanitize(raw_output), reserved_names)
+
+
+def quarantine(output_dir: Path, file_name: str, raw_output: str, problems: List[str]) -> Path:
+    """Park a rejected output next to the tests, out of the build's test_*.cpp glob"""
+    quarantine_dir = Path(output_dir) / QUARANTINE_DIR
+    quarantine_dir.mkdir(parents=True, exist_ok=True)
+    target = quarantine_dir / file_name
+    target.write_text(raw_output, encoding='utf-8')
+    target.with_suffix(target.suffix + ".reasons.txt").write_text("\n".join(problems) + "\n", encoding='utf-8')
+    logger.warning(f"Quarantined {file_name}: {'; '.join(problems)}")
+    return target
+
+
+def retry_instructions(problems: List[str], answer: str = WHOLE_FILE_ANSWER) -> str:
+    """Prompt suffix asking the model to fix exactly what the gate rejected, answering in the stage's format"""
+    return (
+        "\n\nYour previous answer was rejected by an automatic check:\n"
+        + "\n".join(f"- {problem}" for problem in problems)
+        + f"\nReturn {answer}."
+    )
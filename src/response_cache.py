@@ -0,0 +1,49 @@
+"""
+Response cache
+Bounded LRU of model responses keyed like coalesced requests, kept by long-running
+generators so a repeated prompt is answered without a provider call
+"""
+
+import threading
+from collections import OrderedDict
+from typing import Optional
+
+
+class ResponseCache:
+    """Thread-safe LRU from request key to response text"""
+
+    def __init__(self, max_entries: int = 2048):
+        self.max_entries = max_entries
+        self.hits = 0
+        self.misses = 0
+        self._entries: "OrderedDict[str, str]" = OrderedDict()
+        self._lock = threading.Lock()
+
+    def get(self, key: str) -> Optional[str]:
+        with self._lock:
+            response = self._entries.get(key)
+            if response is None:
+                self.misses += 1
+                return None
+            self._entries.move_to_end(key)
+            self.hits += 1
+            return response
+
+    def put(self, key: str, response: str):
+        with self._lock:
+            self._entries[key] = response
+            self._entries.move_to_end(key)
+            while len(self._entries) > self.max_entries:
+                self._entries.popitem(last=False)
+
+    def forget(self, response: str) -> int:
+        """Drop every entry answering with response, e.g. one the output gate rejected; returns entries dropped"""
+        with self._lock:
+            keys = [key for key, cached in self._entries.items() if cached == response]
+            for key in keys:
+                del self._entries[key]
+            return len(keys)
+
+    def __len__(self) -> int:
+        with self._lock:
+            return len(self._entries)
@@ -0,0 +1,147 @@
+"""
+Local JSON-RPC server
+JSON-RPC 2.0 over a Unix domain socket, one request or response per line, so
+editor integrations and CI can drive a warm generator without process startup
+"""
+
+import os
+import json
+import inspect
+import time
+import socket
+import logging
+import threading
+import socketserver
+from pathlib import Path
+from typing import Any, Callable, Dict, Optional
+
+logger = logging.getLogger(__name__)
+
+PARSE_ERROR = -32700
+INVALID_REQUEST = -32600
+METHOD_NOT_FOUND = -32601
+INVALID_PARAMS = -32602
+SERVER_ERROR = -32000
+
+
+class RpcError(Exception):
+    def __init__(self, code: int, message: str):
+        super().__init__(message)
+        self.code = code
+
+
+class AlreadyServing(Exception):
+    """Another server is listening on the socket path"""
+
+
+class _Handler(socketserver.StreamRequestHandler):
+    def handle(self):
+        for line in self.rfile:
+            if not line.strip():
+                continue
+            response = self.server.rpc.dispatch_line(line)
+            if response is not None:
+                self.wfile.write((json.dumps(response) + "\n").encode('utf-8'))
+                self.wfile.flush()
+
+
+class _Server(socketserver.ThreadingMixIn, socketserver.UnixStreamServer):
+    daemon_threads = True
+
+
+class RpcServer:
+    """Dispatches JSON-RPC requests to registered methods; calls to exclusive methods run one at a time"""
+
+    def __init__(self, socket_path: Path):
+        self.socket_path = Path(socket_path)
+        self.methods: Dict[str, Callable[..., Any]] = {}
+        self.exclusive = set()
+        self._busy = threading.Lock()
+        self._server: Optional[_Server] = None
+
+    def register(self, name: str, method: Callable[..., Any], exclusive: bool = True):
+        self.methods[name] = method
+        if exclusive:
+            self.exclusive.add(name)
+
+    def dispatch_line(self, line: bytes) -> Optional[Dict[str, Any]]:
+        try:
+            request = json.loads(line)
+        except ValueError as e:
+            return {"jsonrpc": "2.0", "id": None, "error": {"code": PARSE_ERROR, "message": str(e)}}
+        request_id = request.get("id") if isinstance(request, dict) else None
+        try:
+            result = self.dispatch(request)
+        except RpcError as e:
+            return {"jsonrpc": "2.0", "id": request_id, "error": {"code": e.code, "message": str(e)}}
+        except Exception as e:
+            logger.error(f"RPC {request.get('method')} failed: {e}")
+            return {"jsonrpc": "2.0", "id": request_id, "error": {"code": SERVER_ERROR, "message": str(e)}}
+        # Notifications (no id) get no response
+        return None if request_id is None else {"jsonrpc": "2.0", "id": request_id, "result": result}
+
+    def dispatch(self, request: Any) -> Any:
+        if not isinstance(request, dict) or not isinstance(request.get("method"), str):
+            raise RpcError(INVALID_REQUEST, "Expected an object with a method")
+        name = request["method"]
+        method = self.methods.get(name)
+        if method is None:
+            raise RpcError(METHOD_NOT_FOUND, f"Unknown method {name}")
+        params = request.get("params") or {}
+        if not isinstance(params, dict):
+            raise RpcError(INVALID_PARAMS, "params must be an object")
+
+        try:
+            inspect.signature(method).bind(**params)
+        except TypeError as e:
+            raise RpcError(INVALID_PARAMS, str(e))
+
+        start = time.perf_counter()
+        if name in self.exclusive:
+            with self._busy:
+                result = method(**params)
+        else:
+            result = method(**params)
+        logger.info(f"RPC {name} took {time.perf_counter() - start:.2f}s")
+        return {"value": result, "elapsed_s": round(time.perf_counter() - start, 3)}
+
+    def serve_forever(self):
+        if self.socket_path.exists():
+            # Only a socket nobody answers on is left over from a crashed server and safe to replace
+            with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as probe:
+                try:
+                    probe.connect(str(self.socket_path))
+                except OSError:
+                    pass
+                else:
+                    raise AlreadyServing(f"A server is already listening on {self.socket_path}")
+            self.socket_path.unlink()
+        self._server = _Server(str(self.socket_path), _Handler)
+        self._server.rpc = self
+        os.chmod(self.socket_path, 0o600)
+        logger.info(f"Listening on {self.socket_path}")
+        try:
+            self._server.serve_forever()
+        finally:
+            self._server.server_close()
+            self.socket_path.unlink(missing_ok=True)
+
+    def shutdown(self):
+        """Stop serving once the current request has been answered"""
+        if self._server is not None:
+            threading.Thread(target=self._server.shutdown, daemon=True).start()
+
+
+def rpc_call(socket_path: Path, method: str, params: Optional[Dict[str, Any]] = None,
+             timeout: Optional[float] = None) -> Any:
+    """Send one request and return its result, raising RpcError for error responses"""
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as sock:
+        sock.settimeout(timeout)
+        sock.connect(str(socket_path))
+        sock.sendall((json.dumps({"jsonrpc": "2.0", "id": 1, "method": method, "params": params or {}}) + "\n")
+                     .encode('utf-8'))
+        with sock.makefile('rb') as stream:
+            response = json.loads(stream.readline())
+    if "error" in response:
+        raise RpcError(response["error"]["code"], response["error"]["message"])
+    return response["result"]
@@ -0,0 +1,108 @@
+"""
+Sharding across machines
+Deterministically splits sources into N shards balanced by estimated token cost,
+and merges the output directories of the shards back into one
+"""
+
+import json
+import shutil
+import hashlib
+import logging
+from pathlib import Path
+from typing import Callable, Dict, List, Sequence, Tuple
+
+from chunking import merge_test_files
+from test_records import dedupe_test_files
+
+logger = logging.getLogger(__name__)
+
+SHARD_INFO_NAME = "shard.json"
+
+# Written once per shard by identical inputs, so any shard's copy will do
+SHARED_OUTPUTS = ("generated_mocks.h", "test_support")
+
+
+def parse_shard(spec: str) -> Tuple[int, int]:
+    """'i/N' with 1 <= i <= N"""
+    try:
+        index, count = (int(part) for part in spec.split('/'))
+    except ValueError:
+        raise ValueError(f"Shard must look like i/N, got {spec!r}")
+    if count < 1 or not 1 <= index <= count:
+        raise ValueError(f"Shard index must be between 1 and {count}, got {spec!r}")
+    return index, count
+
+
+def stable_hash(key: str) -> int:
+    """Hash that is identical on every machine and Python process (unlike hash())"""
+    return int.from_bytes(hashlib.sha1(key.encode('utf-8')).digest()[:8], 'big')
+
+
+def assign_shards(keys: Sequence[str], count: int, cost: Callable[[str], int]) -> Dict[str, int]:
+    """Shard (1-based) per key, greedily balancing total cost
+
+    The heaviest files are placed first, each on the currently lightest shard; ties are broken
+    by a stable hash of the key, so every machine computes the same split from the same tree.
+    """
+    loads = [0] * count
+    assignment = {}
+    for key in sorted(keys, key=lambda k: (-cost(k), stable_hash(k), k)):
+        shard = min(range(count), key=lambda s: (loads[s], s))
+        loads[shard] += max(1, cost(key))
+        assignment[key] = shard + 1
+    return assignment
+
+
+def _merge_json(paths: List[Path]) -> Dict:
+    merged: Dict = {}
+    for path in paths:
+        try:
+            merged.update(json.loads(path.read_text(encoding='utf-8')))
+        except (OSError, ValueError) as e:
+            logger.warning(f"Skipping unreadable {path}: {e}")
+    return merged
+
+
+def merge_shard_outputs(shard_dirs: List[Path], output_dir: Path, manifest_name: str) -> Dict[str, int]:
+    """Combine per-shard test files, shared headers, manifests and coverage additions into output_dir
+
+    Returns counts for the report; metrics and the report itself are merged by the caller.
+    """
+    output_dir.mkdir(parents=True, exist_ok=True)
+    counts = {"merged_shards": len(shard_dirs), "merged_test_files": 0, "merged_test_conflicts": 0}
+
+    tests: Dict[str, List[str]] = {}
+    for shard_dir in shard_dirs:
+        for test_file in sorted(shard_dir.glob("test_*.cpp")):
+            tests.setdefault(test_file.name, []).append(test_file.read_text(encoding='utf-8'))
+    for name, versions in sorted(tests.items()):
+        distinct = list(dict.fromkeys(versions))
+        if len(distinct) > 1:
+            # Sources with the same stem in different directories landed on different shards
+            counts["merged_test_conflicts"] += 1
+        (output_dir / name).write_text(distinct[0] if len(distinct) == 1 else merge_test_files(distinct),
+                                       encoding='utf-8')
+        counts["merged_test_files"] += 1
+    # Older shard runs split header/source pairs, and each shard claimed test names on its own
+    counts["merged_tests_renamed"] = dedupe_test_files(sorted(output_dir / name for name in tests))
+
+    for shared in SHARED_OUTPUTS:
+        source = next((shard_dir / shared for shard_dir in shard_dirs if (shard_dir / shared).exists()), None)
+        if source is None:
+            continue
+        target = output_dir / shared
+        if source.is_dir():
+            shutil.copytree(source, target, dirs_exist_ok=True)
+        else:
+            shutil.copy2(source, target)
+
+    manifest = _merge_json([shard_dir / manifest_name for shard_dir in shard_dirs
+                            if (shard_dir / manifest_name).is_file()])
+    (output_dir / manifest_name).write_text(json.dumps(manifest, indent=2, sort_keys=True), encoding='utf-8')
+
+    improvements = [(shard_dir / "coverage_improvements.cpp").read_text(encoding='utf-8')
+                    for shard_dir in shard_dirs if (shard_dir / "coverage_improvements.cpp").is_file()]
+    if improvements:
+        (output_dir / "coverage_improvements.cpp").write_text(merge_test_files(improvements), encoding='utf-8')
+
+    return counts
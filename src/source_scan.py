@@ -0,0 +1,178 @@
+"""
+Project source discovery
+One parallel os.scandir walk that prunes excluded directories before descending,
+honors .gitignore files, and matches C++ extensions in the same pass
+"""
+
+import os
+import re
+import logging
+from concurrent.futures import FIRST_COMPLETED, ThreadPoolExecutor, wait
+from fnmatch import fnmatchcase
+from pathlib import Path
+from typing import Iterable, List, Optional, Sequence, Tuple
+
+logger = logging.getLogger(__name__)
+
+SOURCE_EXTENSIONS = frozenset({'.cpp', '.cc', '.cxx', '.c++', '.h', '.hpp', '.hxx', '.h++'})
+
+# Globs without '/' match an entry's name, globs with '/' its project-relative path;
+# a later '!glob' takes back what earlier globs excluded, as in .gitignore
+DEFAULT_EXCLUDES = (
+    '.git', '.svn', '.hg', 'build', 'build-*', 'cmake-build-*', '_deps', 'CMakeFiles',
+    'third_party', 'third-party', 'thirdparty', 'external', 'vendor', 'node_modules',
+    'test', 'tests', 'unittest', 'unittests',
+    'test_*', '*_test.*', '*_tests.*', '*Test.*', '*Tests.*',
+)
+
+
+class GitIgnoreRule:
+    """One .gitignore pattern compiled to a regex over paths relative to the file's directory"""
+
+    def __init__(self, pattern: str):
+        self.negate = pattern.startswith('!')
+        pattern = pattern[1:] if self.negate else pattern
+        self.dir_only = pattern.endswith('/')
+        pattern = pattern.rstrip('/')
+        anchored = '/' in pattern
+        body = self._translate(pattern.lstrip('/'))
+        self.regex = re.compile(('^' if anchored else r'^(?:.*/)?') + body + '$')
+
+    @staticmethod
+    def _translate(pattern: str) -> str:
+        out = []
+        index = 0
+        while index < len(pattern):
+            if pattern.startswith('**/', index):
+                out.append(r'(?:.*/)?')
+                index += 3
+            elif pattern.startswith('/**', index) and index + 3 == len(pattern):
+                out.append(r'/.*')
+                index += 3
+            elif pattern.startswith('**', index):
+                out.append(r'.*')
+                index += 2
+            elif pattern[index] == '*':
+                out.append(r'[^/]*')
+                index += 1
+            elif pattern[index] == '?':
+                out.append(r'[^/]')
+                index += 1
+            elif pattern[index] == '[' and ']' in pattern[index + 1:]:
+                end = pattern.index(']', index + 1)
+                out.append('[' + pattern[index + 1:end].replace('!', '^', 1) + ']')
+                index = end + 1
+            else:
+                out.append(re.escape(pattern[index]))
+                index += 1
+        return ''.join(out)
+
+    def matches(self, relative: str, is_dir: bool) -> bool:
+        return (is_dir or not self.dir_only) and self.regex.match(relative) is not None
+
+
+def load_gitignore(path: Path) -> List[GitIgnoreRule]:
+    try:
+        lines = path.read_text(encoding='utf-8', errors='replace').splitlines()
+    except OSError:
+        return []
+    rules = []
+    for line in lines:
+        line = line.rstrip()
+        if not line or line.startswith('#'):
+            continue
+        rules.append(GitIgnoreRule(line[1:] if line.startswith('\\') else line))
+    return rules
+
+
+# (directory relative to the root, rules of the .gitignore found there), outermost first
+IgnoreStack = Tuple[Tuple[str, Tuple[GitIgnoreRule, ...]], ...]
+
+
+class SourceScanner:
+    """Finds C++ sources under a root in a single pruned, parallel directory walk"""
+
+    def __init__(self, root: Path, extensions: Iterable[str] = SOURCE_EXTENSIONS,
+                 exclude: Sequence[str] = DEFAULT_EXCLUDES, respect_gitignore: bool = True,
+                 workers: Optional[int] = None):
+        self.root = Path(root)
+        self.extensions = frozenset(ext.lower() for ext in extensions)
+        # (negated, matches the path rather than the name, glob) in order; the last match decides
+        self.rules = []
+        for glob in exclude:
+            negate = glob.startswith('!')
+            glob = glob[1:].strip('/') if negate else glob.strip('/')
+            self.rules.append((negate, '/' in glob, glob))
+        self.negations = any(negate for negate, _, _ in self.rules)
+        self.respect_gitignore = respect_gitignore
+        self.workers = workers or min(32, (os.cpu_count() or 4) * 4)
+
+    def _excluded(self, name: str, relative: str) -> bool:
+        if not self.negations:
+            return any(fnmatchcase(relative if by_path else name, glob) for _, by_path, glob in self.rules)
+        verdict = False
+        for negate, by_path, glob in self.rules:
+            if fnmatchcase(relative if by_path else name, glob):
+                verdict = not negate
+        return verdict
+
+    def excluded(self, path: Path) -> bool:
+        """True if path, or a directory above it within the root, matches an exclude glob"""
+        try:
+            parts = Path(path).relative_to(self.root).parts
+        except ValueError:
+            return True
+        return any(self._excluded(parts[index], '/'.join(parts[:index + 1])) for index in range(len(parts)))
+
+    def wanted(self, path: Path) -> bool:
+        """True for a source file the scan would return, .gitignore aside"""
+        return Path(path).suffix.lower() in self.extensions and not self.excluded(path)
+
+    @staticmethod
+    def _ignored(relative: str, is_dir: bool, ignores: IgnoreStack) -> bool:
+        verdict = False
+        for base, rules in ignores:
+            local = relative[len(base) + 1:] if base else relative
+            for rule in rules:
+                if rule.matches(local, is_dir):
+                    verdict = not rule.negate
+        return verdict
+
+    def _scan_dir(self, directory: str, relative: str, ignores: IgnoreStack):
+        if self.respect_gitignore:
+            rules = load_gitignore(Path(directory) / '.gitignore')
+            if rules:
+                ignores = ignores + ((relative, tuple(rules)),)
+
+        files: List[str] = []
+        subdirs: List[Tuple[str, str, IgnoreStack]] = []
+        try:
+            with os.scandir(directory) as entries:
+                for entry in entries:
+                    child = f"{relative}/{entry.name}" if relative else entry.name
+                    try:
+                        is_dir = entry.is_dir(follow_symlinks=False)
+                    except OSError:
+                        continue
+                    if self._excluded(entry.name, child) or (ignores and self._ignored(child, is_dir, ignores)):
+                        continue
+                    if is_dir:
+                        subdirs.append((entry.path, child, ignores))
+                    elif os.path.splitext(entry.name)[1].lower() in self.extensions and entry.is_file():
+                        files.append(entry.path)
+        except OSError as e:
+            logger.warning(f"Cannot scan {directory}: {e}")
+        return files, subdirs
+
+    def scan(self) -> List[Path]:
+        """Return matching files in sorted order"""
+        found: List[str] = []
+        with ThreadPoolExecutor(max_workers=self.workers) as executor:
+            pending = {executor.submit(self._scan_dir, str(self.root), '', ())}
+            while pending:
+                done, pending = wait(pending, return_when=FIRST_COMPLETED)
+                for future in done:
+                    files, subdirs = future.result()
+                    found.extend(files)
+                    pending.update(executor.submit(self._scan_dir, *subdir) for subdir in subdirs)
+        return [Path(path) for path in sorted(found)]
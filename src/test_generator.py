@@ -5,16 +5,48 @@ Supports Ollama, GitHub Models, and other LLM providers
 """
 
 import os
+import re
 import sys
+import copy
 import json
 import yaml
 import subprocess
 import argparse
 import logging
+import threading
+import time
+from collections import Counter
+from concurrent.futures import ThreadPoolExecutor, as_completed
+from contextlib import contextmanager
 from pathlib import Path
-from typing import List, Dict, Any, Optional
+from typing import List, Dict, Any, Optional, Set
 import requests
-from dataclasses import dataclass
+from dataclasses import asdict, dataclass, replace
+
+from include_graph import IncludeGraph, file_digest
+from mock_generator import MockGenerator, MockClass, MOCKS_HEADER_NAME
+from test_support import TestSupportLibrary, TEST_SUPPORT_DIR, TEST_SUPPORT_HEADER
+from output_gate import WHOLE_FILE_ANSWER, GateResult, gate, quarantine, retry_instructions
+from edit_ops import EDIT_LIST_ANSWER, apply_edit_ops, edit_retry_instructions, parse_edit_ops
+from test_quality import drop_tests, extract_test_blocks, project_symbols, quality_retry_instructions, score_tests
+from metrics import PipelineMetrics, estimate_tokens
+from model_router import ModelRouter
+from compile_check import SyntaxChecker
+from source_scan import DEFAULT_EXCLUDES, SourceScanner
+from chunking import Chunk, merge_test_files, split_source
+from build_fix_session import BuildFixSession, diagnostics_by_file, flatten_messages
+from admission import AdmissionController
+from checkpoint import CHECKPOINT_NAME, Checkpoint, write_atomic
+from job_queue import QUEUE_NAME, Heartbeat, JobQueue, worker_name
+from sharding import SHARD_INFO_NAME, assign_shards, merge_shard_outputs, parse_shard
+from response_cache import ResponseCache
+from rpc_server import AlreadyServing, RpcError, RpcServer, rpc_call
+from fs_watch import ChangeBatch, SourceWatcher
+from cassette import Cassette, CassetteWriter, cassette_key, chat_key
+from singleflight import Singleflight, request_key
+from test_records import (RECORDS_ANSWER, assemble, claim_test_names, dedupe_test_files, parse_test_body,
+                          parse_test_records, replace_test_body, tests_at_lines)
+from tracing import Tracer, traced
 
 # Configure logging
 logging.basicConfig(
@@ -38,46 +70,178 @@ class GeneratorConfig:
     api_url: Optional[str] = None
     temperature: float = 0.2
     max_tokens: int = 4000
+    incremental: bool = False  # only regenerate tests invalidated by source changes
+    jobs: int = 1  # concurrent generation requests within one include-graph layer
+    mock_include_dirs: Optional[List[str]] = None  # where to find Drogon headers for shared mocks
+    gate_retries: int = 1  # re-prompts for output rejected by the local gate before quarantining it
+    min_test_score: float = 0.5  # share of tests that must assert on project code to accept a file
+    stage_routing: bool = True  # honor model/temperature/max_tokens from each stage's YAML
+    cli_settings: Optional[List[str]] = None  # model_name/temperature/max_tokens set on the command line; win over YAML
+    seed: Optional[int] = None  # sampling seed, varied per candidate in best-of-N generation
+    candidates: int = 1  # parallel candidates for hard files; 1 disables best-of-N
+    candidate_models: Optional[List[str]] = None  # extra 'provider:model' entries for the candidate pool
+    hard_file_tokens: int = 1500  # sources at least this large are treated as hard
+    build_fix_rounds: int = 3  # rebuild/repair iterations before giving up on a failing build
+    structured_output: bool = True  # request JSON test records and assemble test files locally
+    coalesce: bool = True  # share one provider call between identical prompts in flight at the same time
+    token_budgets: Optional[Dict[str, int]] = None  # per-provider in-flight token budget, overrides project config
+    exclude_globs: Optional[List[str]] = None  # extra name/path globs skipped when scanning the project
+    respect_gitignore: bool = True  # skip files and directories ignored by the project's .gitignore files
+    chunk_tokens: Optional[int] = None  # sources above this many tokens are split per class/function; None uses max_tokens, 0 disables
+    keep_alive: str = "30m"  # how long Ollama keeps models loaded after each request
+    max_context: int = 32768  # upper bound for the per-request Ollama num_ctx
+    resume: bool = False  # continue from the checkpoint journal instead of starting over
+    workers: int = 0  # worker processes pulling generation jobs from the SQLite queue; 0 generates in-process
+    shard: Optional[str] = None  # "i/N": only generate this shard's token-balanced share of the sources
+    record: Optional[str] = None  # append every provider request/response/latency to this cassette
+    replay: Optional[str] = None  # answer from this cassette instead of calling a model
+    replay_speed: float = 1.0  # replayed latencies are divided by this; 0 answers instantly
+    trace: Optional[str] = None  # span trace file: Chrome trace events for a .json suffix, JSONL otherwise
 
 class LLMProvider:
     """Base class for LLM providers"""
     
     def __init__(self, config: GeneratorConfig):
         self.config = config
+        self.metrics: Optional[PipelineMetrics] = None  # attached by the generator
+        self.session = requests.Session()  # keeps connections to the API open between requests
     
     def generate_response(self, prompt: str, system_prompt: str = "") -> str:
         """Generate response from LLM"""
         raise NotImplementedError
+    
+    def chat(self, messages: List[Dict[str, str]]) -> str:
+        """Continue a conversation; providers without a chat endpoint get it flattened into one prompt"""
+        prompt, system_prompt = flatten_messages(messages)
+        return self.generate_response(prompt, system_prompt)
+    
+    def warm_up(self) -> float:
+        """Load the model ahead of the first real request; returns seconds spent"""
+        return 0.0
+    
+    def _count(self, name: str, amount: float = 1):
+        if self.metrics is not None:
+            self.metrics.increment(name, amount)
 
 class OllamaProvider(LLMProvider):
     """Ollama LLM provider"""
     
+    MIN_CONTEXT = 2048
+    COLD_LOAD_SECONDS = 0.5  # load_duration above this means the model was (re)loaded for the request
+    
     def __init__(self, config: GeneratorConfig):
         super().__init__(config)
         self.api_url = config.api_url or "http://localhost:11434/api/generate"
+        self.num_ctx = 0  # high-water mark; shrinking num_ctx would reload the model too
+        self.chars_per_token = 4.0  # calibrated from prompt_eval_count as responses come in
+        self.cold_load_s: Optional[float] = None
+        self._lock = threading.Lock()
+    
+    def _context_size(self, prompt: str) -> int:
+        """Pick num_ctx for a prompt: power-of-two bucket, never below what is already allocated"""
+        needed = int(len(prompt) / self.chars_per_token * 1.1) + self.config.max_tokens
+        size = self.MIN_CONTEXT
+        while size < needed and size < self.config.max_context:
+            size *= 2
+        size = min(size, self.config.max_context)
+        with self._lock:
+            if size > self.num_ctx:
+                if self.num_ctx:
+                    self._count("ollama_ctx_reallocations")
+                self.num_ctx = size
+            elif size != self.num_ctx:
+                # Sized for this prompt alone, the context would have reloaded the runner
+                self._count("ollama_ctx_reallocations_avoided")
+            return self.num_ctx
+    
+    def _payload(self, prompt: str) -> Dict[str, Any]:
+        return dict(self._request_fields(prompt), prompt=prompt)
+    
+    def _request_fields(self, text: str) -> Dict[str, Any]:
+        """Fields shared by /api/generate and /api/chat requests"""
+        keep_alive = str(self.config.keep_alive)
+        payload = {
+            "model": self.config.model_name,
+            "stream": False,
+            "keep_alive": int(keep_alive) if re.fullmatch(r'-?\d+', keep_alive) else keep_alive,
+            "options": {
+                "temperature": self.config.temperature,
+                "num_predict": self.config.max_tokens,
+                "num_ctx": self._context_size(text)
+            }
+        }
+        if self.config.seed is not None:
+            payload["options"]["seed"] = self.config.seed
+        return payload
+    
+    def _observe(self, prompt: str, result: Dict[str, Any]):
+        """Calibrate the token estimate and account for model loads"""
+        evaluated = result.get('prompt_eval_count') or 0
+        # Cached prefixes shrink prompt_eval_count, so only plausible ratios are trusted
+        if evaluated and 1.5 <= len(prompt) / evaluated <= 8.0:
+            with self._lock:
+                self.chars_per_token = 0.7 * self.chars_per_token + 0.3 * (len(prompt) / evaluated)
+        
+        load_s = (result.get('load_duration') or 0) / 1e9
+        if load_s > self.COLD_LOAD_SECONDS:
+            self._count("ollama_cold_loads")
+            self._count("ollama_load_seconds", load_s)
+            with self._lock:
+                self.cold_load_s = max(self.cold_load_s or 0.0, load_s)
+        elif self.cold_load_s and self.cold_load_s > self.COLD_LOAD_SECONDS:
+            self._count("ollama_cold_load_seconds_saved", self.cold_load_s - load_s)
+    
+    def warm_up(self) -> float:
+        """Preload the model with an empty prompt and pin it for the keep_alive period"""
+        start = time.perf_counter()
+        try:
+            payload = self._payload("")
+            payload.pop("prompt")
+            response = self.session.post(self.api_url, json=payload, timeout=300)
+            response.raise_for_status()
+            load_s = (response.json().get('load_duration') or 0) / 1e9
+        except Exception as e:
+            logger.warning(f"Could not preload Ollama model {self.config.model_name}: {e}")
+            return 0.0
+        elapsed = time.perf_counter() - start
+        with self._lock:
+            self.cold_load_s = max(self.cold_load_s or 0.0, load_s)
+        self._count("ollama_warmup_seconds", elapsed)
+        logger.info(f"Preloaded {self.config.model_name} in {elapsed:.1f}s (num_ctx {self.num_ctx}, "
+                    f"keep_alive {self.config.keep_alive})")
+        return elapsed
     
     def generate_response(self, prompt: str, system_prompt: str = "") -> str:
         """Generate response using Ollama"""
         try:
-            payload = {
-                "model": self.config.model_name,
-                "prompt": f"{system_prompt}\n\n{prompt}",
-                "stream": False,
-                "options": {
-                    "temperature": self.config.temperature,
-                    "num_predict": self.config.max_tokens
-                }
-            }
-            
-            response = requests.post(self.api_url, json=payload, timeout=120)
+            full_prompt = f"{system_prompt}\n\n{prompt}"
+            response = self.session.post(self.api_url, json=self._payload(full_prompt), timeout=120)
             response.raise_for_status()
             
             result = response.json()
+            self._observe(full_prompt, result)
             return result.get('response', '')
             
         except Exception as e:
             logger.error(f"Error calling Ollama API: {e}")
             raise
+    
+    def chat(self, messages: List[Dict[str, str]]) -> str:
+        """Continue a conversation through /api/chat; earlier turns stay in the server's prompt cache"""
+        try:
+            text = "\n\n".join(message["content"] for message in messages)
+            payload = dict(self._request_fields(text), messages=messages)
+            chat_url = re.sub(r'/api/generate$', '/api/chat', self.api_url)
+            response = self.session.post(chat_url, json=payload, timeout=120)
+            response.raise_for_status()
+            
+            result = response.json()
+            self._observe(text, result)
+            return result.get('message', {}).get('content', '')
+            
+        except Exception as e:
+            logger.error(f"Error calling Ollama chat API: {e}")
+            raise
 
 class GitHubModelsProvider(LLMProvider):
     """GitHub Models provider using Azure AI Inference SDK"""
@@ -89,7 +253,7 @@ class GitHubModelsProvider(LLMProvider):
         
         try:
             from azure.ai.inference import ChatCompletionsClient
-            from azure.ai.inference.models import SystemMessage, UserMessage
+            from azure.ai.inference.models import AssistantMessage, SystemMessage, UserMessage
             from azure.core.credentials import AzureKeyCredential
             
             endpoint = "https://models.github.ai"
@@ -99,6 +263,7 @@ class GitHubModelsProvider(LLMProvider):
             )
             self.SystemMessage = SystemMessage
             self.UserMessage = UserMessage
+            self.AssistantMessage = AssistantMessage
         except ImportError as e:
             raise ImportError("azure-ai-inference package is required for GitHub Models") from e
     
@@ -114,7 +279,26 @@ class GitHubModelsProvider(LLMProvider):
                 messages=messages,
                 temperature=self.config.temperature,
                 max_tokens=self.config.max_tokens,
-                model=self.config.model_name
+                model=self.config.model_name,
+                seed=self.config.seed
+            )
+            
+            return response.choices[0].message.content
+            
+        except Exception as e:
+            logger.error(f"Error calling GitHub Models API: {e}")
+            raise
+    
+    def chat(self, messages: List[Dict[str, str]]) -> str:
+        """Continue a conversation with the chat completions API"""
+        try:
+            roles = {"system": self.SystemMessage, "user": self.UserMessage, "assistant": self.AssistantMessage}
+            response = self.client.complete(
+                messages=[roles[message["role"]](message["content"]) for message in messages],
+                temperature=self.config.temperature,
+                max_tokens=self.config.max_tokens,
+                model=self.config.model_name,
+                seed=self.config.seed
             )
             
             return response.choices[0].message.content
@@ -157,11 +341,13 @@ class GeminiProvider(LLMProvider):
                     "topK": 10
                 }
             }
+            if self.config.seed is not None:
+                data["generationConfig"]["seed"] = self.config.seed
             
             # Add API key to URL
             url = f"{self.api_url}?key={self.config.api_key}"
             
-            response = requests.post(url, headers=headers, json=data, timeout=30)
+            response = self.session.post(url, headers=headers, json=data, timeout=30)
             response.raise_for_status()
             
             result = response.json()
@@ -176,53 +362,320 @@ class GeminiProvider(LLMProvider):
             logger.error(f"Error calling Gemini API: {e}")
             raise
 
+class RecordingProvider(LLMProvider):
+    """Passes calls through to a real provider and appends each exchange, with its latency, to a cassette"""
+    
+    def __init__(self, inner: LLMProvider, writer: CassetteWriter):
+        self.inner = inner
+        super().__init__(inner.config)
+        self.writer = writer
+    
+    @property
+    def metrics(self) -> Optional[PipelineMetrics]:
+        return self._metrics
+    
+    @metrics.setter
+    def metrics(self, metrics: Optional[PipelineMetrics]):
+        # The wrapped provider keeps counting its own events (model loads, context sizes)
+        self._metrics = metrics
+        self.inner.metrics = metrics
+    
+    def warm_up(self) -> float:
+        return self.inner.warm_up()
+    
+    def generate_response(self, prompt: str, system_prompt: str = "") -> str:
+        start = time.perf_counter()
+        response = self.inner.generate_response(prompt, system_prompt)
+        self.writer.record(cassette_key(self.config.model_name, self.config.seed, system_prompt, prompt),
+                           self.config.model_name, {"system_prompt": system_prompt, "prompt": prompt},
+                           response, time.perf_counter() - start)
+        self._count("cassette_records")
+        return response
+    
+    def chat(self, messages: List[Dict[str, str]]) -> str:
+        start = time.perf_counter()
+        response = self.inner.chat(messages)
+        self.writer.record(chat_key(self.config.model_name, self.config.seed, messages),
+                           self.config.model_name, {"messages": messages}, response, time.perf_counter() - start)
+        self._count("cassette_records")
+        return response
+
+class ReplayProvider(LLMProvider):
+    """Answers from a cassette, taking the recorded latency divided by replay_speed"""
+    
+    def __init__(self, config: GeneratorConfig, cassette: Cassette):
+        super().__init__(config)
+        self.cassette = cassette
+    
+    def _replay(self, key: str, request: Dict[str, Any]) -> str:
+        found = self.cassette.lookup(key, request)
+        if found is None:
+            self._count("replay_misses")
+            raise LookupError(f"No recorded response for this {self.config.model_name} request in {self.cassette.path}")
+        response, latency = found
+        if self.config.replay_speed > 0:
+            time.sleep(latency / self.config.replay_speed)
+        self._count("replay_hits")
+        return response
+    
+    def generate_response(self, prompt: str, system_prompt: str = "") -> str:
+        return self._replay(cassette_key(self.config.model_name, self.config.seed, system_prompt, prompt),
+                            {"system_prompt": system_prompt, "prompt": prompt})
+    
+    def chat(self, messages: List[Dict[str, str]]) -> str:
+        return self._replay(chat_key(self.config.model_name, self.config.seed, messages), {"messages": messages})
+
+# One reader/writer per cassette path, shared by the routed and seeded providers of a process
+_cassettes: Dict[str, Any] = {}
+_cassettes_lock = threading.Lock()
+
+def _open_cassette(kind, path: str):
+    with _cassettes_lock:
+        key = f"{kind.__name__}:{Path(path).resolve()}"
+        if key not in _cassettes:
+            _cassettes[key] = kind(Path(path))
+        return _cassettes[key]
+
+def create_llm_provider(config: GeneratorConfig) -> Optional[LLMProvider]:
+    """Create appropriate LLM provider based on configuration"""
+    if config.replay:
+        return ReplayProvider(config, _open_cassette(Cassette, config.replay))
+    if config.model_provider.lower() == 'ollama':
+        provider = OllamaProvider(config)
+    elif config.model_provider.lower() == 'github':
+        provider = GitHubModelsProvider(config)
+    elif config.model_provider.lower() == 'mock':
+        # Return None for mock provider, will be replaced in demo
+        return None
+    elif config.model_provider.lower() == 'gemini':
+        provider = GeminiProvider(config)
+    else:
+        raise ValueError(f"Unsupported model provider: {config.model_provider}")
+    if config.record:
+        return RecordingProvider(provider, _open_cassette(CassetteWriter, config.record))
+    return provider
+
+# gtest result lines and compiler error locations used to narrow fixes to single tests
+FAILED_TEST_PATTERN = re.compile(r'^\[  FAILED  \] (\w+\.\w+)(?: \(\d+ ms\))?$', re.MULTILINE)
+ERROR_LOCATION_PATTERN = re.compile(r':(\d+)(?::\d+)?: (?:fatal )?error: ')
+
+# Default socket of serve mode, inside the output directory
+SOCKET_NAME = ".generator.sock"
+
+# Seconds between queue polls of the coordinator and idle workers
+WORKER_POLL_S = 0.2
+
+# Pipeline stages, named after their YAML instruction files
+STAGES = ['initial_test_generation', 'test_refinement', 'build_fix', 'coverage_improvement']
+
 class CppTestGenerator:
     """Main C++ unit test generator class"""
     
     def __init__(self, config: GeneratorConfig):
         self.config = config
+        self.tracer = Tracer(Path(config.trace) if config.trace else None)
+        self.tracer.capture_errors(logger)
         self.llm_provider = self._create_llm_provider()
         self.project_path = Path(config.project_path)
         self.output_dir = Path(config.output_dir)
         self.config_dir = Path(__file__).parent.parent / "config"
+        self._yaml_cache: Dict[str, tuple] = {}  # config name -> (mtime, parsed YAML)
+        
+        project_config = self.project_config = self._load_project_config()
+        self.metrics = PipelineMetrics(project_config.get('cost_per_1k_tokens'))
+        if isinstance(self.llm_provider, LLMProvider):
+            self.llm_provider.metrics = self.metrics
+        self.router = ModelRouter(
+            config,
+            {stage: self.load_yaml_config(stage) for stage in STAGES},
+            self._new_provider,
+            enabled=config.stage_routing and config.model_provider.lower() != 'mock'
+        )
         
         # Create output directory
         self.output_dir.mkdir(parents=True, exist_ok=True)
+        self.manifest_path = self.output_dir / ".generation_manifest.json"
+        self._manifest_lock = threading.Lock()
+        self.shared_mocks: List[MockClass] = []
+        self.test_support: Optional[TestSupportLibrary] = None
+        self.fix_sessions: Dict[str, BuildFixSession] = {}
+        self.inflight = Singleflight()
+        self.admission = AdmissionController(dict(project_config.get('token_budget') or {},
+                                                  **(config.token_budgets or {})))
+        self.checkpoint = Checkpoint(self.output_dir / CHECKPOINT_NAME)
+        
+        # Kept between requests by long-running generators (serve mode); see keep_warm()
+        self.warm = False
+        self.response_cache: Optional[ResponseCache] = None
+        self._index: Optional[tuple] = None  # (file stat signature, include graph)
+        self._test_names: Dict[str, str] = {}  # source key -> test file name, see _assign_test_names
+        self._test_owners: Optional[Dict[str, Set[str]]] = None  # test file -> Suite.Name of its tests
+        self._defined_tests: Counter = Counter()  # Suite.Name -> test files defining it
         
-    def _create_llm_provider(self) -> LLMProvider:
+    def keep_warm(self, cache_entries: int = 2048):
+        """Keep the project index and model responses in memory between requests"""
+        self.warm = True
+        self.response_cache = ResponseCache(cache_entries)
+    
+    def _create_llm_provider(self) -> Optional[LLMProvider]:
         """Create appropriate LLM provider based on configuration"""
-        if self.config.model_provider.lower() == 'ollama':
-            return OllamaProvider(self.config)
-        elif self.config.model_provider.lower() == 'github':
-            return GitHubModelsProvider(self.config)
-        elif self.config.model_provider.lower() == 'mock':
-            # Return None for mock provider, will be replaced in demo
-            return None
-        elif self.config.model_provider.lower() == 'gemini':
-            return GeminiProvider(self.config)
-        else:
-            raise ValueError(f"Unsupported model provider: {self.config.model_provider}")
+        return create_llm_provider(self.config)
+    
+    def _new_provider(self, config: GeneratorConfig) -> Optional[LLMProvider]:
+        """Create a provider that reports into this run's metrics"""
+        provider = create_llm_provider(config)
+        if isinstance(provider, LLMProvider):
+            provider.metrics = self.metrics
+        return provider
+    
+    def warm_up_models(self) -> float:
+        """Preload the default model and every stage's model before the first file is sent"""
+        providers = [self.llm_provider]
+        for stage in STAGES:
+            try:
+                provider = self.router.provider_for(self.router.route(stage))
+            except Exception as e:
+                logger.debug(f"No warm-up for {stage}: {e}")
+                continue
+            if provider is not None and provider not in providers:
+                providers.append(provider)
+        
+        # Sequential on purpose: loading several models at once on one GPU evicts them again
+        seen = set()
+        total = 0.0
+        for provider in providers:
+            if not isinstance(provider, LLMProvider):
+                continue
+            key = (type(provider), provider.config.model_name)
+            if key not in seen:
+                seen.add(key)
+                total += provider.warm_up()
+        return total
+    
+    def _load_project_config(self) -> Dict[str, Any]:
+        """Load config/project_config.json"""
+        try:
+            with open(self.config_dir / "project_config.json", 'r', encoding='utf-8') as f:
+                return json.load(f)
+        except Exception as e:
+            logger.warning(f"Could not load project config: {e}")
+            return {}
+    
+    def _call_llm(self, stage: str, prompt: str, system_prompt: str = "") -> str:
+        """Send one prompt through the stage router, recording latency, tokens and cost"""
+        routed = self._routed_provider(stage, prompt, system_prompt)
+        response, _ = self._with_fallback(
+            stage, routed, lambda *provider: self._timed_call(stage, *provider, prompt, system_prompt))
+        return response
+    
+    def _default_provider(self) -> tuple:
+        return self.llm_provider, self.config.model_provider, self.config.model_name
+    
+    def _with_fallback(self, stage: str, routed: tuple, call, fallback: Optional[tuple] = None) -> tuple:
+        """Run call(provider, provider name, model name) on the routed provider, retrying once on the
+        fallback (default: the CLI provider) when it fails; returns (result, provider tuple that answered)"""
+        fallback = fallback or self._default_provider()
+        try:
+            return call(*routed), routed
+        except Exception:
+            if routed[0] is fallback[0] or routed[1:] == fallback[1:]:
+                raise
+            # A routed model that is missing or down should not stall the stage
+            logger.warning(f"{routed[1]}:{routed[2]} failed for {stage}, retrying with {fallback[1]}:{fallback[2]}")
+            return call(*fallback), fallback
+    
+    def _routed_provider(self, stage: str, prompt: str, system_prompt: str):
+        """Return (provider, provider name, model name) the router picks for this prompt"""
+        route = self.router.route(stage, estimate_tokens(system_prompt) + estimate_tokens(prompt))
+        try:
+            provider = self.router.provider_for(route)
+        except Exception as e:
+            logger.warning(f"Cannot create {route.provider}:{route.model_name} for {stage}, using default: {e}")
+            provider = None
+        if provider is None:
+            return self.llm_provider, self.config.model_provider, self.config.model_name
+        logger.debug(f"{stage} routed to {route.provider}:{route.model_name} ({route.reason})")
+        return provider, route.provider, route.model_name
+    
+    @traced('llm', 'llm_call', attrs=lambda stage, provider, provider_name, model_name, *rest: {"stage": stage, "provider": provider_name, "model": model_name})
+    def _timed_call(self, stage: str, provider: LLMProvider, provider_name: str, model_name: str,
+                    prompt: str, system_prompt: str) -> str:
+        """Call a provider, recording latency, tokens and cost for the stage"""
+        prompt_tokens = estimate_tokens(system_prompt) + estimate_tokens(prompt)
+        key = self._request_key(provider, provider_name, model_name, prompt, system_prompt)
+        if self.response_cache is not None:
+            cached = self.response_cache.get(key)
+            if cached is not None:
+                self.metrics.increment("response_cache_hits")
+                self.metrics.increment("response_cache_tokens_saved", prompt_tokens + estimate_tokens(cached))
+                self.tracer.annotate(cached=True, prompt_tokens=prompt_tokens)
+                return cached
+        start = time.perf_counter()
+        try:
+            def send() -> str:
+                with self._admitted(provider, provider_name, prompt_tokens):
+                    return provider.generate_response(prompt, system_prompt)
+            
+            if self.config.coalesce:
+                response, shared = self.inflight.do(key, send)
+            else:
+                response, shared = send(), False
+        except Exception:
+            self.metrics.record_call(stage, provider_name, model_name, time.perf_counter() - start,
+                                     prompt_tokens, 0, ok=False)
+            raise
+        if shared:
+            # Another caller's request answered this one; no provider time or tokens were spent
+            self.metrics.increment("coalesced_calls")
+            self.metrics.increment("coalesced_tokens_saved", prompt_tokens + estimate_tokens(response))
+            self.tracer.annotate(coalesced=True, prompt_tokens=prompt_tokens)
+            return response
+        latency = time.perf_counter() - start
+        self.router.observe_model(model_name, latency)
+        self.metrics.record_call(stage, provider_name, model_name, latency, prompt_tokens, estimate_tokens(response))
+        self.tracer.annotate(prompt_tokens=prompt_tokens, completion_tokens=estimate_tokens(response))
+        if self.response_cache is not None:
+            self.response_cache.put(key, response)
+        return response
+    
+    @contextmanager
+    def _admitted(self, provider, provider_name: str, prompt_tokens: int):
+        """Hold the provider's token budget for the prompt plus the completion it may produce"""
+        max_tokens = getattr(getattr(provider, 'config', None), 'max_tokens', self.config.max_tokens)
+        with self.admission.admit(provider_name, prompt_tokens + max_tokens) as waited:
+            if waited > 0.01:
+                self.metrics.increment("admission_queued")
+                self.metrics.increment("admission_wait_seconds", waited)
+            yield
+    
+    @staticmethod
+    def _request_key(provider, provider_name: str, model_name: str, prompt: str, system_prompt: str) -> str:
+        """Identify a request by everything that shapes its response, including the sampling seed"""
+        config = getattr(provider, 'config', None)
+        sampling = (getattr(config, 'temperature', None), getattr(config, 'max_tokens', None),
+                    getattr(config, 'seed', None))
+        return request_key(provider_name, model_name, sampling, system_prompt, prompt)
     
     def find_cpp_files(self) -> List[Path]:
         """Find all C++ source and header files in the project"""
-        cpp_files = []
-        
-        # Common C++ file extensions
-        extensions = {'.cpp', '.cc', '.cxx', '.c++', '.h', '.hpp', '.hxx', '.h++'}
-        
-        for ext in extensions:
-            cpp_files.extend(self.project_path.rglob(f'*{ext}'))
-        
-        # Filter out test files and third-party code
-        filtered_files = []
-        for file_path in cpp_files:
-            path_str = str(file_path).lower()
-            if not any(skip in path_str for skip in ['test', 'third_party', 'build', '.git']):
-                filtered_files.append(file_path)
+        filtered_files = self._scanner().scan()
+        self._assign_test_names(filtered_files)
         
         logger.info(f"Found {len(filtered_files)} C++ files to generate tests for")
         return filtered_files
     
+    def _scanner(self) -> SourceScanner:
+        """Source scanner for the project"""
+        # Build trees, VCS metadata, third-party code, tests and our own output are pruned before descending
+        exclude = list(DEFAULT_EXCLUDES) + list(self.project_config.get('scan_exclude') or [])
+        exclude += self.config.exclude_globs or []
+        try:
+            exclude.append(self.output_dir.resolve().relative_to(self.project_path.resolve()).as_posix())
+        except ValueError:
+            pass
+        
+        return SourceScanner(self.project_path, exclude=exclude, respect_gitignore=self.config.respect_gitignore)
+    
     def read_file_content(self, file_path: Path) -> str:
         """Read content of a C++ file"""
         try:
@@ -233,79 +686,769 @@ class CppTestGenerator:
             return ""
     
     def load_yaml_config(self, config_name: str) -> Dict[str, Any]:
-        """Load YAML configuration file"""
+        """Load YAML configuration file, parsing it again only when it changed on disk"""
         config_path = self.config_dir / f"{config_name}.yaml"
         try:
-            with open(config_path, 'r', encoding='utf-8') as f:
-                return yaml.safe_load(f)
+            mtime = config_path.stat().st_mtime_ns
+            cached = self._yaml_cache.get(config_name)
+            if cached is None or cached[0] != mtime:
+                with open(config_path, 'r', encoding='utf-8') as f:
+                    cached = self._yaml_cache[config_name] = (mtime, yaml.safe_load(f))
+            return copy.deepcopy(cached[1])
         except Exception as e:
             logger.error(f"Error loading config {config_name}: {e}")
             return {}
     
-    def generate_initial_tests(self) -> bool:
-        """Generate initial unit tests for all C++ files"""
+    def _project_index(self) -> tuple[List[Path], IncludeGraph]:
+        """Scan the project and build its include graph, shared mocks and test support
+        
+        A warm generator reuses all of it until a source is added, removed or modified.
+        """
+        cpp_files = self.find_cpp_files()
+        signature = []
+        for cpp_file in cpp_files:
+            stat = cpp_file.stat()
+            signature.append((cpp_file, stat.st_mtime_ns, stat.st_size))
+        if self.warm and self._index is not None and self._index[0] == signature:
+            self.metrics.increment("project_index_reused")
+            return cpp_files, self._index[1]
+        
+        graph = IncludeGraph(self.project_path, cpp_files)
+        self.shared_mocks = self._generate_shared_mocks(cpp_files)
+        self.test_support = self._generate_test_support(cpp_files)
+        if self.warm:
+            self._index = (signature, graph)
+        return cpp_files, graph
+    
+    @traced('stage')
+    def generate_initial_tests(self, only: Optional[List[Path]] = None) -> bool:
+        """Generate initial unit tests for all C++ files, or only for the given ones"""
         logger.info("Starting initial test generation...")
+        self._test_owners = None  # test files may have changed since the last run
         
         config = self.load_yaml_config('initial_test_generation')
         if not config:
             logger.error("Failed to load initial test generation config")
             return False
         
-        cpp_files = self.find_cpp_files()
+        cpp_files, graph = self._project_index()
         if not cpp_files:
             logger.warning("No C++ files found to generate tests for")
             return False
         
+        manifest = self._load_manifest()
+        
+        targets = cpp_files
+        if only is not None:
+            wanted = {Path(path).resolve() for path in only}
+            targets = [cpp_file for cpp_file in cpp_files if cpp_file.resolve() in wanted]
+        elif self.config.incremental and manifest:
+            targets = sorted(graph.dependents(self._changed_files(cpp_files, manifest)))
+            logger.info(f"Incremental run: {len(targets)}/{len(cpp_files)} files invalidated")
+            if not targets:
+                logger.info("All generated tests are up to date")
+                return True
+        
+        if self.config.shard:
+            targets = self._shard_targets(cpp_files, targets)
+        
+        total = len(targets)
         success_count = 0
+        if self.config.resume:
+            done = {cpp_file for cpp_file in targets if self._checkpointed(cpp_file, manifest)}
+            targets = [cpp_file for cpp_file in targets if cpp_file not in done]
+            success_count = sum(self._test_file_for(cpp_file).is_file() for cpp_file in done)
+            logger.info(f"Resuming: {len(done)} files already generated, {len(targets)} to go")
+        else:
+            # Only this run's targets start over; an --incremental run keeps the journal of untouched files
+            self.checkpoint.forget(self._test_file_for(cpp_file).name for cpp_file in targets)
         
+        # Leaf modules first, so dependents can be prompted with their fixtures and mocks
+        layers = graph.generation_layers(targets)
+        
+        if self.config.workers > 0:
+            success_count += self._generate_with_workers(layers, cpp_files, manifest)
+            self._dedupe_test_names()
+        else:
+            for depth, layer in enumerate(layers):
+                logger.info(f"Generating layer {depth}: {len(layer)} files")
+                with ThreadPoolExecutor(max_workers=max(1, self.config.jobs)) as executor:
+                    results = list(executor.map(
+                        self.tracer.wrap(lambda cpp_file: self._generate_test_for_file(cpp_file, config, graph,
+                                                                                      manifest)),
+                        layer
+                    ))
+                success_count += sum(results)
+        
+        self._save_manifest(manifest)
+        logger.info(f"Successfully generated tests for {success_count}/{total} files")
+        return success_count > 0
+    
+    def _shard_targets(self, cpp_files: List[Path], targets: List[Path]) -> List[Path]:
+        """Keep this shard's targets; the split is computed over the whole tree, so every shard agrees on it"""
+        index, count = parse_shard(self.config.shard)
+        # Sources sharing a stem (a header and its .cc) stay together, so their test names are claimed in one run
+        costs: Dict[str, int] = {}
         for cpp_file in cpp_files:
-            try:
-                logger.info(f"Generating tests for {cpp_file.name}")
-                
-                # Read the source file
-                source_code = self.read_file_content(cpp_file)
-                if not source_code.strip():
-                    logger.warning(f"Empty or unreadable file: {cpp_file}")
+            costs[cpp_file.stem] = costs.get(cpp_file.stem, 0) + max(1, cpp_file.stat().st_size // 4)
+        assignment = assign_shards(list(costs), count, costs.__getitem__)
+        mine = [cpp_file for cpp_file in targets if assignment.get(cpp_file.stem) == index]
+        tokens = sum(max(1, cpp_file.stat().st_size // 4) for cpp_file in mine)
+        logger.info(f"Shard {index}/{count}: {len(mine)}/{len(targets)} files, ~{tokens} source tokens")
+        self.metrics.increment("shard_files", len(mine))
+        self.metrics.increment("shard_source_tokens", tokens)
+        
+        write_atomic(self.output_dir / SHARD_INFO_NAME, json.dumps({
+            "shard": self.config.shard,
+            "project_path": str(self.project_path),
+            "model_provider": self.config.model_provider,
+            "model_name": self.config.model_name,
+            "files": [self._manifest_key(cpp_file) for cpp_file in mine],
+        }, indent=2))
+        return mine
+    
+    def _generate_with_workers(self, layers: List[List[Path]], cpp_files: List[Path],
+                               manifest: Dict[str, Any]) -> int:
+        """Fan generation out to worker processes through the SQLite job queue, one include layer at a time"""
+        queue = JobQueue(self.output_dir / QUEUE_NAME)
+        queue.reset()
+        # Workers must not reset the journal this run is writing
+        queue.set_meta('config', asdict(replace(self.config, resume=True, workers=0)))
+        queue.set_meta('files', [self._manifest_key(cpp_file) for cpp_file in cpp_files])
+        
+        processes = [self._spawn_worker(queue.path) for _ in range(self.config.workers)]
+        restarts = 0
+        success_count = 0
+        try:
+            for depth, layer in enumerate(layers):
+                logger.info(f"Queueing layer {depth}: {len(layer)} files for {len(processes)} workers")
+                ids = queue.enqueue('generate', [{"source": self._manifest_key(cpp_file)} for cpp_file in layer])
+                while not queue.finished(ids):
+                    for index, process in enumerate(processes):
+                        if process.poll() is None:
+                            continue
+                        # A crashed worker's leases expire and its jobs go to the others; replace it
+                        if restarts >= self.config.workers * queue.max_attempts:
+                            if all(p.poll() is not None for p in processes):
+                                raise RuntimeError("All generation workers exited")
+                            continue
+                        logger.warning(f"Worker {process.pid} exited with {process.returncode}, restarting")
+                        processes[index] = self._spawn_worker(queue.path)
+                        restarts += 1
+                    time.sleep(WORKER_POLL_S)
+                for result in queue.results(ids).values():
+                    if result and result["manifest"]:
+                        manifest[result["source"]] = result["manifest"]
+                    if result and result["ok"]:
+                        success_count += 1
+        finally:
+            queue.set_meta('closed', True)
+            for process in processes:
+                try:
+                    process.wait(timeout=60)
+                except subprocess.TimeoutExpired:
+                    process.terminate()
+            for snapshot in queue.worker_metrics():
+                self.metrics.merge(snapshot)
+            self.metrics.increment("worker_processes", len(queue.workers()))
+            self.metrics.increment("worker_restarts", restarts)
+            queue.close()
+        return success_count
+    
+    def _spawn_worker(self, queue_path: Path) -> subprocess.Popen:
+        return subprocess.Popen([sys.executable, str(Path(__file__).resolve()), "worker", "--queue", str(queue_path)])
+    
+    def work(self, queue: JobQueue, name: str) -> int:
+        """Pull generation jobs from the queue until the coordinator closes it; returns jobs completed"""
+        cpp_files = [self.project_path / key for key in queue.meta('files', [])]
+        self._assign_test_names(cpp_files)
+        graph = IncludeGraph(self.project_path, cpp_files)
+        self.shared_mocks = self._generate_shared_mocks(cpp_files, write=False)
+        self.test_support = self._generate_test_support(cpp_files, write=False)
+        config = self.load_yaml_config('initial_test_generation')
+        heartbeat = Heartbeat(queue)
+        completed = []
+        queue.register(name)
+        
+        def loop(lessee: str):
+            while True:
+                job = queue.lease(lessee)
+                if job is None:
+                    if queue.meta('closed'):
+                        return
+                    time.sleep(WORKER_POLL_S)
                     continue
-                
-                # Create prompt
-                prompt = self._create_initial_test_prompt(cpp_file, source_code, config)
-                system_prompt = config['instructions']['role']
-                
-                # Generate tests
-                generated_test = self.llm_provider.generate_response(prompt, system_prompt)
-                
-                if generated_test.strip():
-                    # Save generated test
-                    test_file_name = f"test_{cpp_file.stem}.cpp"
-                    test_file_path = self.output_dir / test_file_name
-                    
-                    with open(test_file_path, 'w', encoding='utf-8') as f:
-                        f.write(generated_test)
-                    
-                    logger.info(f"Generated test file: {test_file_path}")
-                    success_count += 1
-                else:
-                    logger.warning(f"No test generated for {cpp_file}")
-                    
+                heartbeat.hold(job.id, lessee)
+                try:
+                    source = job.payload["source"]
+                    entries: Dict[str, Any] = {}
+                    ok = self._generate_test_for_file(self.project_path / source, config, graph, entries)
+                    queue.complete(job.id, lessee, {"source": source, "ok": ok, "manifest": entries.get(source)})
+                    completed.append(job.id)
+                except Exception as e:
+                    logger.error(f"Job {job.id} failed on attempt {job.attempts}: {e}")
+                    queue.fail(job.id, lessee, str(e))
+                finally:
+                    heartbeat.release(job.id)
+                queue.register(name, len(completed), self.metrics.to_dict())
+        
+        try:
+            with ThreadPoolExecutor(max_workers=max(1, self.config.jobs)) as executor:
+                list(executor.map(self.tracer.wrap(loop), [f"{name}/{index}" for index in range(max(1, self.config.jobs))]))
+        finally:
+            heartbeat.stop()
+            queue.register(name, len(completed), self.metrics.to_dict())
+        return len(completed)
+    
+    @traced('file', attrs=lambda cpp_file, *rest: {"file": cpp_file.name})
+    def _generate_test_for_file(self, cpp_file: Path, config: Dict[str, Any],
+                                graph: IncludeGraph, manifest: Dict[str, Any]) -> bool:
+        """Generate and save the test file for a single source file"""
+        try:
+            logger.info(f"Generating tests for {cpp_file.name}")
+            
+            # Read the source file
+            source_code = self.read_file_content(cpp_file)
+            if not source_code.strip():
+                logger.warning(f"Empty or unreadable file: {cpp_file}")
+                return False
+            
+            # Create prompt
+            helpers = self._collect_dependency_helpers(cpp_file, graph)
+            prompt = self._create_initial_test_prompt(cpp_file, source_code, config, helpers)
+            system_prompt = config['instructions']['role']
+            
+            # Generate tests; hard files, or files whose single sample failed, get best-of-N sampling
+            test_file_path = self._test_file_for(cpp_file)
+            best_of_n = self.config.candidates > 1
+            generated_test = None
+            chunk_tokens = self.config.max_tokens if self.config.chunk_tokens is None else self.config.chunk_tokens
+            chunks = split_source(source_code, chunk_tokens) if chunk_tokens else []
+            if len(chunks) > 1:
+                generated_test = self._generate_chunked(cpp_file, chunks, config, helpers, system_prompt)
+            elif not best_of_n or estimate_tokens(source_code) < self.config.hard_file_tokens:
+                generated_test = self._generate_gated(test_file_path.name, prompt, system_prompt, source_code)
+            if generated_test is None and best_of_n and len(chunks) <= 1:
+                generated_test = self._generate_best_of_n(test_file_path.name, prompt, system_prompt, source_code)
+            
+            if generated_test is None:
+                logger.warning(f"No usable test generated for {cpp_file}")
+                digest = file_digest(cpp_file)
+                self.checkpoint.mark(test_file_path.name, 'quarantined', self._manifest_key(cpp_file), digest)
+                # Recorded without a test file, so incremental runs skip it until the source changes
+                with self._manifest_lock:
+                    previous = manifest.get(self._manifest_key(cpp_file), {}).get("test_file")
+                    manifest[self._manifest_key(cpp_file)] = {"digest": digest, "test_file": None}
+                    if previous and (previous == test_file_path.name or previous not in self._test_names.values()):
+                        (self.output_dir / previous).unlink(missing_ok=True)
+                self._end_fix_session(test_file_path.name)
+                return False
+            
+            # Save generated test
+            generated_test = self._claim_test_names(test_file_path.name, generated_test)
+            write_atomic(test_file_path, generated_test)
+            self._end_fix_session(test_file_path.name)
+            digest = file_digest(cpp_file)
+            self.checkpoint.mark(test_file_path.name, 'generated', self._manifest_key(cpp_file), digest)
+            
+            with self._manifest_lock:
+                previous = manifest.get(self._manifest_key(cpp_file), {}).get("test_file")
+                manifest[self._manifest_key(cpp_file)] = {
+                    "digest": digest,
+                    "test_file": test_file_path.name
+                }
+                # Before per-source names a header and its source shared one test file
+                if previous and previous != test_file_path.name and previous not in self._test_names.values():
+                    (self.output_dir / previous).unlink(missing_ok=True)
+            
+            logger.info(f"Generated test file: {test_file_path}")
+            return True
+            
+        except Exception as e:
+            logger.error(f"Error generating test for {cpp_file}: {e}")
+            return False
+    
+    def _generate_chunked(self, cpp_file: Path, chunks: List[Chunk], config: Dict[str, Any],
+                          helpers: str, system_prompt: str) -> Optional[str]:
+        """Generate tests for each chunk of a large source in parallel and merge them into one file"""
+        test_file = self._test_file_for(cpp_file)
+        logger.info(f"Splitting {cpp_file.name} into {len(chunks)} chunks")
+        self.metrics.increment("chunked_files")
+        
+        def generate(numbered):
+            number, chunk = numbered
+            part = f"part {number}/{len(chunks)}: {chunk.label}" if chunk.label else f"part {number}/{len(chunks)}"
+            prompt = self._create_initial_test_prompt(cpp_file, chunk.text, config, helpers, part)
+            return self._generate_gated(f"{test_file.stem}.part{number}{test_file.suffix}", prompt, system_prompt,
+                                        chunk.text)
+        
+        with ThreadPoolExecutor(max_workers=min(len(chunks), os.cpu_count() or 4)) as executor:
+            parts = [part for part in executor.map(self.tracer.wrap(generate), enumerate(chunks, 1)) if part is not None]
+        self.metrics.increment("chunks_generated", len(parts))
+        self.metrics.increment("chunks_failed", len(chunks) - len(parts))
+        if not parts:
+            return None
+        
+        merged = merge_test_files(parts)
+        result = gate(merged, self._reserved_names())
+        if not result.ok:
+            quarantine(self.output_dir, test_file.name, merged, result.problems)
+            return None
+        return result.content
+    
+    def _reserved_names(self) -> List[str]:
+        """Classes and helpers generated tests must take from the shared headers"""
+        reserved = [mock.mock_name for mock in self.shared_mocks]
+        if self.test_support:
+            reserved += self.test_support.helper_names()
+        return reserved
+    
+    def _generate_gated(self, file_name: str, prompt: str, system_prompt: str,
+                        source_code: str = "", stage: str = 'initial_test_generation',
+                        edit_base: Optional[str] = None) -> Optional[str]:
+        """Call the model and pass its output through the local gates, re-prompting on rejection
+        
+        With edit_base, the model answers with edit operations that are applied to that content.
+        """
+        reserved = self._reserved_names()
+        symbols = project_symbols(source_code) if source_code else set()
+        
+        # Retries ask for the same kind of answer as the prompt, or edit savings turn into full rewrites
+        if edit_base is not None:
+            answer = EDIT_LIST_ANSWER
+        elif stage == 'initial_test_generation' and self.config.structured_output:
+            answer = RECORDS_ANSWER
+        else:
+            answer = WHOLE_FILE_ANSWER
+        suffix = ""
+        for attempt in range(self.config.gate_retries + 1):
+            raw_output = self._call_llm(stage, prompt + suffix, system_prompt)
+            candidate = raw_output
+            if edit_base is not None:
+                candidate, edit_problems = self._apply_edit_response(stage, edit_base, raw_output)
+                if candidate is None:
+                    # An empty edit list leaves the file as it is; that is not an improvement to report
+                    logger.info(f"No changes proposed for {file_name}")
+                    self._forget_response(raw_output)
+                    return None
+                if edit_problems:
+                    logger.info(f"Could not apply edits to {file_name}: {'; '.join(edit_problems)}")
+                    result = GateResult(raw_output, edit_problems)
+                    suffix = edit_retry_instructions(edit_problems)
+                    self._forget_response(raw_output)
+                    continue
+            elif stage == 'initial_test_generation':
+                candidate = self._assemble_records(raw_output)
+            result = gate(candidate, reserved)
+            if not result.ok:
+                logger.info(f"Gate rejected {file_name}: {'; '.join(result.problems)}")
+                suffix = retry_instructions(result.problems, answer)
+                self._forget_response(raw_output)
+                continue
+            
+            quality = score_tests(result.content, symbols)
+            if quality.score >= self.config.min_test_score:
+                # Accepted files still shed the placeholders they carry
+                return drop_tests(result.content, quality.trivial) if quality.trivial else result.content
+            logger.info(f"{file_name} has {len(quality.trivial)}/{quality.total} placeholder tests "
+                        f"(score {quality.score:.2f} < {self.config.min_test_score})")
+            suffix = quality_retry_instructions(quality, answer)
+            self._forget_response(raw_output)
+        
+        if result.ok:
+            # Out of retries: keep the tests that do something rather than losing the whole file
+            if quality.meaningful:
+                logger.info(f"Dropping {len(quality.trivial)} placeholder tests from {file_name}")
+                return drop_tests(result.content, quality.trivial)
+            problems = quality.reasons
+        else:
+            problems = result.problems
+        
+        quarantine(self.output_dir, file_name, raw_output, problems)
+        return None
+    
+    def _forget_response(self, raw_output: str):
+        """Keep rejected output out of the response cache, so asking again samples a new answer"""
+        if self.response_cache is not None and self.response_cache.forget(raw_output):
+            self.metrics.increment("response_cache_rejected_dropped")
+    
+    def _assemble_records(self, raw_output: str) -> str:
+        """Assemble a test file from JSON test records; plain-file responses are passed through"""
+        if not self.config.structured_output:
+            return raw_output
+        record = parse_test_records(raw_output)
+        if record is None:
+            self.metrics.increment("structured_fallbacks")
+            return raw_output
+        self.metrics.increment("structured_files")
+        self.metrics.increment("structured_tests", len(record.tests))
+        return assemble(record)
+    
+    def _apply_edit_response(self, stage: str, base: str, raw_output: str) -> tuple[Optional[str], List[str]]:
+        """Turn an edit-list response into file content; a whole-file response is passed through.
+        Content is None when the edits change nothing"""
+        ops = parse_edit_ops(raw_output)
+        if ops is None:
+            self.metrics.increment(f"{stage}_full_rewrites")
+            return raw_output, []
+        
+        content, problems = apply_edit_ops(base, ops)
+        if not problems and content == apply_edit_ops(base, [])[0]:
+            self.metrics.increment(f"{stage}_edit_no_change")
+            return None, []
+        if not problems:
+            # Output tokens actually spent vs what re-emitting the edited file would have cost
+            self.metrics.increment(f"{stage}_edit_responses")
+            self.metrics.increment(f"{stage}_edit_ops", len(ops))
+            self.metrics.increment(f"{stage}_edit_output_tokens", estimate_tokens(raw_output))
+            self.metrics.increment(f"{stage}_full_file_tokens", estimate_tokens(content))
+        return content, problems
+    
+    def _candidate_pool(self, stage: str, prompt: str, system_prompt: str) -> List[tuple]:
+        """(label, provider, provider name, model name) per candidate: extra models, then seeds of the routed one"""
+        pool = []
+        for entry in self.config.candidate_models or []:
+            provider_name, _, model_name = entry.partition(':')
+            try:
+                provider = self._new_provider(self.router.provider_config(provider_name, model_name))
+                pool.append((entry, provider, provider_name, model_name))
             except Exception as e:
-                logger.error(f"Error generating test for {cpp_file}: {e}")
+                logger.warning(f"Skipping candidate model {entry}: {e}")
         
-        logger.info(f"Successfully generated tests for {success_count}/{len(cpp_files)} files")
-        return success_count > 0
+        provider, provider_name, model_name = self._routed_provider(stage, prompt, system_prompt)
+        seed = 0
+        while len(pool) < self.config.candidates:
+            pool.append((f"{provider_name}:{model_name}#seed{seed}", self._seeded(provider, seed),
+                         provider_name, model_name))
+            seed += 1
+        return pool
+    
+    def _seeded(self, provider, seed: int):
+        """A copy of provider sampling with seed; non-LLMProvider stand-ins are used as they are"""
+        if isinstance(provider, LLMProvider):
+            return self._new_provider(replace(provider.config, seed=seed))
+        return provider
+    
+    def _syntax_checker(self) -> SyntaxChecker:
+        """Syntax-only compiler set up with the include dirs the generated CMake uses"""
+        include_dirs = [self.project_path, self.output_dir, self.output_dir / TEST_SUPPORT_DIR]
+        include_dirs += [Path(d) for d in self.config.mock_include_dirs or []]
+        return SyntaxChecker(include_dirs)
+    
+    def _generate_best_of_n(self, file_name: str, prompt: str, system_prompt: str,
+                            source_code: str = "", stage: str = 'initial_test_generation') -> Optional[str]:
+        """Sample candidates concurrently and keep the first that passes the gates and compiles"""
+        pool = self._candidate_pool(stage, prompt, system_prompt)
+        reserved = self._reserved_names()
+        symbols = project_symbols(source_code) if source_code else set()
+        checker = self._syntax_checker()
+        logger.info(f"Sampling {len(pool)} candidates for {file_name}")
+        
+        def evaluate(numbered):
+            number, (label, provider, provider_name, model_name) = numbered
+            started = time.perf_counter()
+            # A failed candidate model falls back to the default one, still with a seed of its own
+            default, default_name, default_model = self._default_provider()
+            fallback = (self._seeded(default, number), default_name, default_model)
+            raw_output, _ = self._with_fallback(
+                stage, (provider, provider_name, model_name),
+                lambda *candidate: self._timed_call(stage, *candidate, prompt, system_prompt), fallback)
+            outcome = {"label": label, "raw": raw_output, "content": None, "compile": None, "score": 0.0}
+            result = gate(self._assemble_records(raw_output), reserved)
+            if not result.ok:
+                outcome["problems"] = result.problems
+                self.metrics.increment("candidates_gate_rejected")
+                self._forget_response(raw_output)
+            else:
+                quality = score_tests(result.content, symbols)
+                outcome["score"] = quality.score
+                if quality.score < self.config.min_test_score:
+                    outcome["problems"] = quality.reasons
+                    self.metrics.increment("candidates_trivial")
+                else:
+                    outcome["content"] = drop_tests(result.content, quality.trivial) if quality.trivial \
+                        else result.content
+                    outcome["compile"] = checker.check(outcome["content"])
+                    self.metrics.increment("candidates_compiled" if outcome["compile"].ok
+                                           else "candidates_compile_failed")
+            self.metrics.increment("candidate_seconds_total", time.perf_counter() - started)
+            return outcome
+        
+        start = time.perf_counter()
+        self.metrics.increment("best_of_n_files")
+        self.metrics.increment("candidates_requested", len(pool))
+        executor = ThreadPoolExecutor(max_workers=len(pool))
+        outcomes = []
+        winner = None
+        try:
+            for future in as_completed([executor.submit(self.tracer.wrap(evaluate), numbered) for numbered in enumerate(pool)]):
+                try:
+                    outcome = future.result()
+                except Exception as e:
+                    logger.warning(f"Candidate for {file_name} failed: {e}")
+                    continue
+                outcomes.append(outcome)
+                if outcome["content"] is not None and outcome["compile"].ok:
+                    winner = outcome
+                    break
+        finally:
+            # Slower candidates are abandoned; their calls finish in the background
+            executor.shutdown(wait=False, cancel_futures=True)
+        self.metrics.increment("best_of_n_wall_seconds", time.perf_counter() - start)
+        
+        if winner is not None:
+            self.metrics.increment("best_of_n_compiled_wins")
+            logger.info(f"Kept candidate {winner['label']} for {file_name}")
+            return winner["content"]
+        
+        usable = [outcome for outcome in outcomes if outcome["content"] is not None]
+        if usable:
+            # Nothing compiled (often missing third-party headers): keep the closest candidate
+            best = min(usable, key=lambda outcome: (outcome["compile"].error_count, -outcome["score"]))
+            self.metrics.increment("best_of_n_fallback_wins")
+            logger.info(f"No candidate for {file_name} compiled; kept {best['label']} "
+                        f"({best['compile'].error_count} errors)")
+            return best["content"]
+        
+        if outcomes:
+            quarantine(self.output_dir, file_name, outcomes[0]["raw"], outcomes[0].get("problems", []))
+        return None
     
-    def _create_initial_test_prompt(self, cpp_file: Path, source_code: str, config: Dict[str, Any]) -> str:
+    def _source_for_test(self, test_file: Path) -> str:
+        """Return the source a test file was generated from, if the manifest knows it"""
+        for key, entry in self._load_manifest().items():
+            if entry.get("test_file") == test_file.name:
+                return self.read_file_content(self.project_path / key)
+        return ""
+    
+    def _test_file_for(self, cpp_file: Path) -> Path:
+        """Return the test file generated for a source file"""
+        name = self._test_names.get(self._manifest_key(cpp_file))
+        return self.output_dir / (name or f"test_{cpp_file.stem}.cpp")
+    
+    def _claim_test_names(self, file_name: str, content: str) -> str:
+        """Rename tests whose Suite.Name another test file already defines; a header and its
+        source are tested in separate files that would otherwise link duplicate test symbols"""
+        with self._manifest_lock:
+            if self._test_owners is None:
+                self._test_owners = {}
+                for test_file in sorted(self.output_dir.glob("test_*.cpp")):
+                    self._test_owners[test_file.name] = {block.full_name for block in
+                                                         extract_test_blocks(self.read_file_content(test_file))}
+                self._defined_tests = Counter(name for names in self._test_owners.values() for name in names)
+            self._defined_tests -= Counter(self._test_owners.pop(file_name, set()))
+            content, mine, renamed = claim_test_names(content, self._defined_tests.keys())
+            self._test_owners[file_name] = mine
+            self._defined_tests += Counter(mine)
+        if renamed:
+            self.metrics.increment("tests_renamed", renamed)
+            logger.info(f"Renamed {renamed} tests in {file_name} already defined by other test files")
+        return content
+    
+    def _dedupe_test_names(self) -> None:
+        """Rename tests defined by several test files; files written by separate worker
+        processes or shards never saw each other's names"""
+        renamed = dedupe_test_files(sorted(self.output_dir.glob("test_*.cpp")))
+        self._test_owners = None
+        if renamed:
+            self.metrics.increment("tests_renamed", renamed)
+            logger.info(f"Renamed {renamed} tests defined by more than one test file")
+    
+    def _assign_test_names(self, cpp_files: List[Path]):
+        """Give every source its own test file: test_<stem>.cpp while the stem is unique, then
+        test_<stem>_<ext>.cpp for a header/source pair, then the mangled project-relative path"""
+        by_stem: Dict[str, List[str]] = {}
+        for cpp_file in cpp_files:
+            by_stem.setdefault(cpp_file.stem, []).append(self._manifest_key(cpp_file))
+        
+        def mangled(key: str) -> str:
+            return re.sub(r'\W', '_', key)
+        
+        names: Dict[str, str] = {}
+        for stem, keys in by_stem.items():
+            if len(keys) == 1:
+                names[keys[0]] = f"test_{stem}.cpp"
+                continue
+            with_ext = {key: f"test_{stem}_{mangled(Path(key).suffix[1:])}.cpp" for key in keys}
+            unique = len(set(with_ext.values())) == len(keys)
+            for key in keys:
+                names[key] = with_ext[key] if unique else f"test_{mangled(key)}.cpp"
+        
+        # A disambiguated name can still meet another stem's plain one (Person_h.cc vs Person.h)
+        taken: Dict[str, int] = {}
+        for name in names.values():
+            taken[name] = taken.get(name, 0) + 1
+        self._test_names = {key: name if taken[name] == 1 else f"test_{mangled(key)}.cpp"
+                            for key, name in names.items()}
+    
+    def _manifest_key(self, cpp_file: Path) -> str:
+        """Key a source file by its project-relative path"""
+        try:
+            return cpp_file.relative_to(self.project_path).as_posix()
+        except ValueError:
+            return cpp_file.as_posix()
+    
+    def _checkpointed(self, cpp_file: Path, manifest: Dict[str, Any]) -> bool:
+        """True if the journal shows this source's test was generated, or its output quarantined,
+        from its current content"""
+        test_file = self._test_file_for(cpp_file)
+        digest = file_digest(cpp_file)
+        key = self._manifest_key(cpp_file)
+        if not self.checkpoint.reached(test_file.name, 'quarantined', digest, key):
+            return False
+        if self.checkpoint.stage(test_file.name) == 'quarantined':
+            manifest[key] = {"digest": digest, "test_file": None}
+            return True
+        if not test_file.is_file():
+            return False
+        # The manifest is only saved at the end of a run, so an interrupted one lost this entry
+        manifest[key] = {"digest": digest, "test_file": test_file.name}
+        return True
+    
+    def _load_manifest(self) -> Dict[str, Any]:
+        """Load the source digests recorded by the previous generation run"""
+        if not self.manifest_path.exists():
+            return {}
+        try:
+            with open(self.manifest_path, 'r', encoding='utf-8') as f:
+                return json.load(f)
+        except Exception as e:
+            logger.warning(f"Ignoring unreadable generation manifest: {e}")
+            return {}
+    
+    def _save_manifest(self, manifest: Dict[str, Any]):
+        """Persist source digests for the next incremental run"""
+        write_atomic(self.manifest_path, json.dumps(manifest, indent=2, sort_keys=True))
+    
+    def _changed_files(self, cpp_files: List[Path], manifest: Dict[str, Any]) -> List[Path]:
+        """Return files that are new, edited, or whose test file has gone missing; a quarantined
+        source (no test file) only counts once it is edited"""
+        changed = []
+        for cpp_file in cpp_files:
+            entry = manifest.get(self._manifest_key(cpp_file))
+            if entry is not None and entry.get("test_file") is None:
+                if entry.get("digest") != file_digest(cpp_file):
+                    changed.append(cpp_file)
+                continue
+            if (entry is None or entry.get("digest") != file_digest(cpp_file)
+                    or entry.get("test_file") != self._test_file_for(cpp_file).name
+                    or not (self.output_dir / entry.get("test_file", "")).is_file()):
+                changed.append(cpp_file)
+        return changed
+    
+    def _collect_dependency_helpers(self, cpp_file: Path, graph: IncludeGraph, limit: int = 4000) -> str:
+        """Collect mock classes and fixtures from tests already generated for included modules"""
+        own_test = self._test_file_for(cpp_file)
+        seen_tests = set()
+        blocks = []
+        size = 0
+        
+        for dependency in sorted(graph.dependencies(cpp_file)):
+            test_file = self._test_file_for(dependency)
+            if test_file == own_test or test_file in seen_tests or not test_file.is_file():
+                continue
+            seen_tests.add(test_file)
+            for block in self._extract_helper_classes(self.read_file_content(test_file)):
+                # Shared mocks are already offered via the generated header; keep the prompt bounded
+                if block in blocks or self._declares_shared_mock(block) or size + len(block) > limit:
+                    continue
+                blocks.append(block)
+                size += len(block)
+        
+        return "\n\n".join(blocks)
+    
+    def _declares_shared_mock(self, block: str) -> bool:
+        """Whether a helper block redefines a class from the shared mocks header"""
+        match = re.match(r'(?:class|struct)\s+(\w+)', block)
+        return match is not None and any(mock.mock_name == match.group(1) for mock in self.shared_mocks)
+    
+    def _generate_shared_mocks(self, cpp_files: List[Path], write: bool = True) -> List[MockClass]:
+        """Write the deterministic gmock header shared by every generated test"""
+        headers = [f for f in cpp_files if f.suffix in {'.h', '.hpp', '.hxx', '.h++'}]
+        uses_drogon = any('<drogon/' in self.read_file_content(f) for f in cpp_files)
+        generator = MockGenerator(self.project_path, self.config.mock_include_dirs)
+        try:
+            if not write:
+                return generator.collect(headers, uses_drogon)
+            return generator.write(headers, self.output_dir / MOCKS_HEADER_NAME, uses_drogon)
+        except Exception as e:
+            logger.error(f"Error generating shared mocks: {e}")
+            return []
+    
+    def _generate_test_support(self, cpp_files: List[Path], write: bool = True) -> Optional[TestSupportLibrary]:
+        """Write the test_support static library shared by every test target"""
+        library = TestSupportLibrary(self.project_path, self.output_dir)
+        try:
+            if not library.scan(cpp_files):
+                return None
+            if write:
+                library.write()
+            return library
+        except Exception as e:
+            logger.error(f"Error generating test_support library: {e}")
+            return None
+    
+    @staticmethod
+    def _extract_helper_classes(test_source: str) -> List[str]:
+        """Extract Mock* classes and ::testing::Test fixtures from a generated test file"""
+        pattern = re.compile(r'^(?:class|struct)\s+(?:Mock\w*\b[^{;]*|\w+\s*:\s*public\s+(?:::)?testing::Test\s*)\{',
+                             re.MULTILINE)
+        blocks = []
+        for match in pattern.finditer(test_source):
+            depth = 0
+            for index in range(match.end() - 1, len(test_source)):
+                if test_source[index] == '{':
+                    depth += 1
+                elif test_source[index] == '}':
+                    depth -= 1
+                    if depth == 0:
+                        end = test_source.find(';', index)
+                        blocks.append(test_source[match.start():end + 1 if end != -1 else index + 1])
+                        break
+        return blocks
+    
+    def _create_initial_test_prompt(self, cpp_file: Path, source_code: str, config: Dict[str, Any],
+                                    helpers: str = "", part: str = "") -> str:
         """Create prompt for initial test generation"""
         instructions = config['instructions']
         
-        prompt = f"""
-{instructions['objective']}
-
-Source File: {cpp_file.name}
-Source Code:
+        mock_section = ""
+        if self.shared_mocks:
+            mock_section = f"""
+Shared Mocks (declared in "{MOCKS_HEADER_NAME}"; #include it and use these instead of defining your own):
+{chr(10).join(f"- {mock.summary()}" for mock in self.shared_mocks)}
+"""
+        
+        support_section = ""
+        if self.test_support:
+            support_section = f"""
+Shared Test Support (#include "{TEST_SUPPORT_HEADER}"; linked into every test, never redefine these):
+{chr(10).join(f"- {declaration}" for declaration in self.test_support.declarations())}
+"""
+        
+        part_note = ""
+        if part:
+            part_note = f" ({part}; an excerpt, test only the definitions shown)"
+        
+        response_section = ""
+        if self.config.structured_output and instructions.get('record_format'):
+            response_section = f"""
+Response Format:
+{instructions['record_format']}"""
+        
+        helper_section = ""
+        if helpers:
+            helper_section = f"""
+Reusable Test Helpers (already generated for included modules; reuse them instead of redefining):
 ```cpp
-{source_code}
+{helpers}
 ```
+"""
+        
+        # Static instructions and run-wide sections first, per-file content last, so local
+        # inference servers can reuse the cached prefix across files
+        prompt = f"""
+{instructions['objective']}
 
 Requirements:
 {chr(10).join(f"- {req}" for req in instructions['requirements'])}
@@ -318,14 +1461,22 @@ Constraints:
 
 Example Structure:
 {instructions['example_structure']}
-
-Please generate comprehensive unit tests for this C++ file following the above requirements.
+{response_section}{mock_section}{support_section}
+Please generate comprehensive unit tests for the C++ file below following the above requirements.
+{helper_section}
+Source File: {cpp_file.name}{part_note}
+Source Code:
+```cpp
+{source_code}
+```
 """
         return prompt
     
+    @traced('stage')
     def refine_tests(self) -> bool:
         """Refine and improve generated tests"""
         logger.info("Starting test refinement...")
+        self._test_owners = None
         
         config = self.load_yaml_config('test_refinement')
         if not config:
@@ -338,35 +1489,50 @@ Please generate comprehensive unit tests for this C++ file following the above r
             return False
         
         success_count = 0
+        if self.config.resume:
+            # Skipped files only count as refined if the earlier run wrote a refinement for them
+            pending = [test_file for test_file in test_files
+                       if not self.checkpoint.reached(test_file.name, 'refine_rejected')]
+            success_count = sum(self.checkpoint.stage(test_file.name) == 'refined'
+                                for test_file in test_files if test_file not in pending)
+            logger.info(f"Resuming: {len(test_files) - len(pending)} files already refined or rejected")
+            test_files, total = pending, len(test_files)
+        else:
+            total = len(test_files)
         
         for test_file in test_files:
-            try:
-                logger.info(f"Refining test file: {test_file.name}")
-                
-                # Read current test content
-                test_content = self.read_file_content(test_file)
-                if not test_content.strip():
-                    continue
-                
-                # Create refinement prompt
-                prompt = self._create_refinement_prompt(test_file, test_content, config)
-                system_prompt = config['instructions']['role']
-                
-                # Get refined tests
-                refined_test = self.llm_provider.generate_response(prompt, system_prompt)
-                
-                if refined_test.strip():
-                    # Save refined test
-                    with open(test_file, 'w', encoding='utf-8') as f:
-                        f.write(refined_test)
+            with self.tracer.span("refine_file", "file", file=test_file.name):
+                try:
+                    logger.info(f"Refining test file: {test_file.name}")
                     
-                    logger.info(f"Refined test file: {test_file}")
-                    success_count += 1
+                    # Read current test content
+                    test_content = self.read_file_content(test_file)
+                    if not test_content.strip():
+                        continue
                     
-            except Exception as e:
-                logger.error(f"Error refining test {test_file}: {e}")
+                    # Create refinement prompt
+                    prompt = self._create_refinement_prompt(test_file, test_content, config)
+                    system_prompt = config['instructions']['role']
+                    
+                    # Get refined tests; rejected output leaves the current file untouched
+                    refined_test = self._generate_gated(test_file.name, prompt, system_prompt,
+                                                        self._source_for_test(test_file), stage='test_refinement',
+                                                        edit_base=test_content)
+                    
+                    if refined_test is not None:
+                        # Save refined test
+                        write_atomic(test_file, self._claim_test_names(test_file.name, refined_test))
+                        self._end_fix_session(test_file.name)
+                        
+                        logger.info(f"Refined test file: {test_file}")
+                        success_count += 1
+                    # A rejected refinement is finished work too; only errors leave the file to be retried
+                    self.checkpoint.mark(test_file.name, 'refined' if refined_test is not None else 'refine_rejected')
+                        
+                except Exception as e:
+                    logger.error(f"Error refining test {test_file}: {e}")
         
-        logger.info(f"Successfully refined {success_count}/{len(test_files)} test files")
+        logger.info(f"Successfully refined {success_count}/{total} test files")
         return success_count > 0
     
     def _create_refinement_prompt(self, test_file: Path, test_content: str, config: Dict[str, Any]) -> str:
@@ -376,67 +1542,82 @@ Please generate comprehensive unit tests for this C++ file following the above r
         prompt = f"""
 {instructions['objective']}
 
-Test File: {test_file.name}
-Current Test Content:
-```cpp
-{test_content}
-```
-
 Refinement Tasks:
 {chr(10).join(f"- {task}" for task in instructions['refinement_tasks'])}
 
 Quality Checks:
 {chr(10).join(f"- {check}" for check in instructions['quality_checks'])}
 
-Please refine these unit tests according to the above requirements.
+Please refine the unit tests below according to the above requirements.
+
+{instructions.get('edit_format', '')}
+
+Test File: {test_file.name}
+Current Test Content:
+```cpp
+{test_content}
+```
 """
         return prompt
     
+    @traced('stage')
     def build_tests(self) -> tuple[bool, str]:
         """Build the generated tests and return success status and output"""
         logger.info("Building generated tests...")
         
-        # Create CMakeLists.txt for tests
+        # Create CMakeLists.txt for tests; an unchanged one is left alone so the build stays up to date
         cmake_content = self._generate_cmake_for_tests()
         cmake_path = self.output_dir / "CMakeLists.txt"
         
-        with open(cmake_path, 'w', encoding='utf-8') as f:
-            f.write(cmake_content)
+        if not cmake_path.is_file() or self.read_file_content(cmake_path) != cmake_content:
+            with open(cmake_path, 'w', encoding='utf-8') as f:
+                f.write(cmake_content)
         
         # Create build directory
         build_dir = self.output_dir / "build"
         build_dir.mkdir(exist_ok=True)
         
         try:
-            # Configure
-            configure_cmd = ["cmake", "..", "-DCMAKE_BUILD_TYPE=Debug"]
-            configure_result = subprocess.run(
-                configure_cmd, 
-                cwd=build_dir, 
-                capture_output=True, 
-                text=True,
-                timeout=300
-            )
-            
-            if configure_result.returncode != 0:
-                logger.error("CMake configuration failed")
-                return False, configure_result.stderr
+            # Configure once; cmake --build reconfigures by itself when CMakeLists.txt changes
+            if (build_dir / "CMakeCache.txt").exists():
+                self.metrics.increment("cmake_configure_skipped")
+            else:
+                configure_cmd = ["cmake", "..", "-DCMAKE_BUILD_TYPE=Debug"]
+                with self.tracer.span("cmake configure", "compile"):
+                    configure_result = subprocess.run(
+                        configure_cmd, 
+                        cwd=build_dir, 
+                        capture_output=True, 
+                        text=True,
+                        timeout=300
+                    )
+                    self.tracer.annotate(returncode=configure_result.returncode)
+                
+                if configure_result.returncode != 0:
+                    logger.error("CMake configuration failed")
+                    # A half-configured cache would make the next build skip configuration
+                    (build_dir / "CMakeCache.txt").unlink(missing_ok=True)
+                    return False, configure_result.stderr
             
             # Build
             build_cmd = ["cmake", "--build", "."]
-            build_result = subprocess.run(
-                build_cmd, 
-                cwd=build_dir, 
-                capture_output=True, 
-                text=True,
-                timeout=600
-            )
+            with self.tracer.span("cmake build", "compile",
+                                  test_files=len(list(self.output_dir.glob("test_*.cpp")))):
+                build_result = subprocess.run(
+                    build_cmd, 
+                    cwd=build_dir, 
+                    capture_output=True, 
+                    text=True,
+                    timeout=600
+                )
+                self.tracer.annotate(returncode=build_result.returncode)
             
             success = build_result.returncode == 0
             output = build_result.stdout + "\n" + build_result.stderr
             
             if success:
                 logger.info("Tests built successfully")
+                self.checkpoint.mark_all((f.name for f in self.output_dir.glob("test_*.cpp")), 'compiled')
             else:
                 logger.error("Build failed")
             
@@ -451,7 +1632,17 @@ Please refine these unit tests according to the above requirements.
     
     def _generate_cmake_for_tests(self) -> str:
         """Generate CMakeLists.txt for the test project"""
-        test_files = [f.name for f in self.output_dir.glob("test_*.cpp")]
+        test_files = sorted(f.name for f in self.output_dir.glob("test_*.cpp"))
+        has_test_support = (self.output_dir / TEST_SUPPORT_DIR / "CMakeLists.txt").is_file()
+        
+        support_section = ""
+        support_library = ""
+        if has_test_support:
+            support_section = f"""
+# Shared fixtures, response checkers and model factories, compiled once
+add_subdirectory({TEST_SUPPORT_DIR})
+"""
+            support_library = "\n    test_support"
         
         cmake_content = f"""cmake_minimum_required(VERSION 3.10)
 project(UnitTests CXX)
@@ -459,24 +1650,29 @@ project(UnitTests CXX)
 set(CMAKE_CXX_STANDARD 17)
 set(CMAKE_CXX_STANDARD_REQUIRED ON)
 
-# Find packages
+# Find packages; GTest's own CMake package ships GMock as GTest::gmock, only
+# some distributions add a separate GMock module
 find_package(GTest REQUIRED)
-find_package(GMock REQUIRED)
+find_package(GMock QUIET)
+if(NOT GMOCK_LIBRARIES AND TARGET GTest::gmock)
+    set(GMOCK_LIBRARIES GTest::gmock)
+endif()
 
 # Include directories
 include_directories(${{GTEST_INCLUDE_DIRS}})
 include_directories(${{GMOCK_INCLUDE_DIRS}})
 include_directories("{self.project_path}")
-
+{support_section}
 # Test executable
 add_executable(run_tests
 {chr(10).join(f"    {test_file}" for test_file in test_files)}
 )
 
-# Link libraries
-target_link_libraries(run_tests
+# Link libraries; gtest_main only supplies main() when no test file defines one
+target_link_libraries(run_tests{support_library}
     ${{GTEST_LIBRARIES}}
     ${{GMOCK_LIBRARIES}}
+    ${{GTEST_MAIN_LIBRARIES}}
     pthread
 )
 
@@ -486,8 +1682,9 @@ add_test(NAME unit_tests COMMAND run_tests)
 """
         return cmake_content
     
+    @traced('stage')
     def fix_build_issues(self, build_output: str) -> bool:
-        """Fix build issues using LLM"""
+        """Repair failing test files in per-file chat sessions, rebuilding after each round"""
         logger.info("Attempting to fix build issues...")
         
         config = self.load_yaml_config('build_fix')
@@ -495,37 +1692,239 @@ add_test(NAME unit_tests COMMAND run_tests)
             logger.error("Failed to load build fix config")
             return False
         
-        # Create fix prompt
-        prompt = self._create_build_fix_prompt(build_output, config)
-        system_prompt = config['instructions']['role']
-        
-        try:
-            # Get fixes from LLM
-            fixes_response = self.llm_provider.generate_response(prompt, system_prompt)
-            
-            # Apply fixes (this would need more sophisticated parsing)
-            # For now, just log the response
-            logger.info("LLM suggested fixes:")
-            logger.info(fixes_response)
+        # Sessions live for one repair loop; the next build may see files this one never did
+        self.fix_sessions.clear()
+        for round_number in range(1, self.config.build_fix_rounds + 1):
+            diagnostics = diagnostics_by_file(build_output)
+            failing = [name for name in sorted(diagnostics)
+                       if name.startswith("test_") and (self.output_dir / name).is_file()]
+            if not failing:
+                logger.warning("Build errors are not located in generated test files")
+                return False
             
-            # TODO: Implement automated fix application
-            return False
+            logger.info(f"Build fix round {round_number}: {len(failing)} failing test files")
+            with ThreadPoolExecutor(max_workers=max(1, self.config.jobs)) as executor:
+                fixed = sum(executor.map(
+                    self.tracer.wrap(lambda name: self._fix_test_file(self.output_dir / name, diagnostics[name],
+                                                                      config)),
+                    failing
+                ))
+            if not fixed:
+                return False
             
+            success, build_output = self.build_tests()
+            if success:
+                logger.info(f"Build fixed after {round_number} round(s)")
+                return True
+        
+        return False
+    
+    @traced('file', attrs=lambda test_file, diagnostics, config: {"file": test_file.name,
+                                                                  "diagnostics": len(diagnostics)})
+    def _fix_test_file(self, test_file: Path, diagnostics: List[str], config: Dict[str, Any]) -> bool:
+        """Send one repair turn for a test file; after the first, only new diagnostics are sent"""
+        test_content = self.read_file_content(test_file)
+        
+        # Errors confined to test bodies only need those tests regenerated
+        failures: Dict[str, List[str]] = {}
+        for diagnostic in diagnostics:
+            location = ERROR_LOCATION_PATTERN.search(diagnostic)
+            owners = tests_at_lines(test_content, [int(location.group(1))]) if location else None
+            if not owners:
+                failures = {}
+                break
+            failures.setdefault(owners[0].full_name, []).append(diagnostic)
+        # If that fails the file is left as it was and still gets its chat repair turn this round
+        if failures and self._regenerate_tests(test_file, failures, config):
+            return True
+        
+        session = self.fix_sessions.get(test_file.name)
+        full_prompt = self._create_build_fix_prompt("\n".join(diagnostics), config, test_file, test_content)
+        
+        if session is None:
+            session = BuildFixSession(test_file.name, config['instructions']['role'])
+            session.provider = self._routed_provider('build_fix', full_prompt, session.messages[0]["content"])
+            self.fix_sessions[test_file.name] = session
+            turn = full_prompt
+            self.metrics.increment("build_fix_sessions")
+        else:
+            turn = session.follow_up(diagnostics)
+            self.metrics.increment("build_fix_resend_tokens_avoided",
+                                   estimate_tokens(full_prompt) - estimate_tokens(turn))
+        session.mark_sent(diagnostics)
+        
+        try:
+            for attempt in range(self.config.gate_retries + 1):
+                session.ask(turn)
+                self.metrics.increment("build_fix_turns")
+                self.metrics.increment("build_fix_turn_tokens", estimate_tokens(turn))
+                # Once the routed model has failed, the rest of the session stays on the fallback
+                reply, session.provider = self._with_fallback(
+                    'build_fix', session.provider,
+                    lambda *provider: self._timed_chat('build_fix', *provider, session.history()))
+                result = gate(reply, self._reserved_names())
+                session.answer(result.content if result.ok else reply)
+                if result.ok:
+                    write_atomic(test_file, self._claim_test_names(test_file.name, result.content))
+                    self.checkpoint.mark(test_file.name, 'refined')
+                    logger.info(f"Applied build fix to {test_file.name} (turn {session.turns})")
+                    return True
+                logger.info(f"Gate rejected build fix for {test_file.name}: {'; '.join(result.problems)}")
+                turn = retry_instructions(result.problems)
         except Exception as e:
-            logger.error(f"Error getting build fixes: {e}")
+            logger.error(f"Error getting build fixes for {test_file.name}: {e}")
+        return False
+    
+    def _end_fix_session(self, file_name: str):
+        """Forget the repair conversation of a test file whose content changed outside it"""
+        self.fix_sessions.pop(file_name, None)
+    
+    @traced('file', attrs=lambda test_file, failures, config: {"file": test_file.name, "tests": len(failures)})
+    def _regenerate_tests(self, test_file: Path, failures: Dict[str, List[str]], config: Dict[str, Any]) -> bool:
+        """Regenerate only the named tests of a file and splice their new bodies back in"""
+        content = self.read_file_content(test_file)
+        system_prompt = config['instructions']['role']
+        
+        def regenerate(full_name: str) -> Optional[str]:
+            prompt = self._create_test_regeneration_prompt(test_file, content, full_name, failures[full_name], config)
+            self.metrics.increment("tests_regenerated")
+            self.metrics.increment("test_regeneration_prompt_tokens", estimate_tokens(prompt))
+            self.metrics.increment("test_regeneration_file_tokens", estimate_tokens(content))
+            try:
+                raw_output = self._call_llm('build_fix', prompt, system_prompt)
+                body = parse_test_body(raw_output, full_name)
+                if body is None:
+                    self._forget_response(raw_output)
+                return body
+            except Exception as e:
+                logger.error(f"Error regenerating {full_name}: {e}")
+                return None
+        
+        with ThreadPoolExecutor(max_workers=max(1, self.config.jobs)) as executor:
+            bodies = dict(zip(failures, executor.map(self.tracer.wrap(regenerate), failures)))
+        
+        updated = content
+        for full_name, body in bodies.items():
+            spliced = replace_test_body(updated, full_name, body) if body is not None else None
+            if spliced is None:
+                logger.info(f"No usable replacement for {full_name}")
+                continue
+            updated = spliced
+        
+        result = gate(updated, self._reserved_names())
+        if updated == content or not result.ok:
+            logger.info(f"Per-test regeneration of {test_file.name} not applied: "
+                        f"{'; '.join(result.problems) or 'no test changed'}")
             return False
+        write_atomic(test_file, result.content)
+        self._end_fix_session(test_file.name)
+        self.checkpoint.mark(test_file.name, 'refined')
+        logger.info(f"Regenerated {', '.join(failures)} in {test_file.name}")
+        return True
     
-    def _create_build_fix_prompt(self, build_output: str, config: Dict[str, Any]) -> str:
-        """Create prompt for build fix"""
+    def _create_test_regeneration_prompt(self, test_file: Path, content: str, full_name: str,
+                                         errors: List[str], config: Dict[str, Any]) -> str:
+        """Prompt with the file's preamble as context and only the failing test to rewrite"""
         instructions = config['instructions']
+        blocks = extract_test_blocks(content)
+        block = next(b for b in blocks if b.full_name == full_name)
+        preamble = content[:blocks[0].start].strip() if blocks else ""
         
         prompt = f"""
 {instructions['objective']}
 
-Build Output/Errors:
+{instructions.get('single_test_format', '')}
+
+Context from {test_file.name} (includes, fixtures and helpers; do not repeat them):
+```cpp
+{preamble[:6000]}
 ```
-{build_output}
+
+Failing Test: {full_name}
+```cpp
+{content[block.start:block.end]}
+```
+
+Errors:
+```
+{chr(10).join(errors)}
+```
+"""
+        return prompt
+    
+    @traced('stage')
+    def fix_failing_tests(self, test_output: str) -> bool:
+        """Regenerate tests that ran and failed, leaving the rest of their files untouched"""
+        config = self.load_yaml_config('build_fix')
+        if not config:
+            return False
+        
+        failed = list(dict.fromkeys(FAILED_TEST_PATTERN.findall(test_output)))
+        if not failed:
+            return False
+        
+        by_file: Dict[Path, Dict[str, List[str]]] = {}
+        for test_file in sorted(self.output_dir.glob("test_*.cpp")):
+            names = {block.full_name for block in extract_test_blocks(self.read_file_content(test_file))}
+            for full_name in failed:
+                if full_name in names:
+                    by_file.setdefault(test_file, {})[full_name] = [self._test_failure_log(test_output, full_name)]
+        
+        logger.info(f"Regenerating {len(failed)} failing tests in {len(by_file)} files")
+        fixed = [self._regenerate_tests(test_file, failures, config) for test_file, failures in by_file.items()]
+        return any(fixed)
+    
+    @staticmethod
+    def _test_failure_log(test_output: str, full_name: str, limit: int = 3000) -> str:
+        """gtest output between a test's RUN and FAILED lines"""
+        start = test_output.find(f"[ RUN      ] {full_name}")
+        end = test_output.find(f"[  FAILED  ] {full_name}", start)
+        if start == -1 or end == -1:
+            return f"{full_name} failed"
+        return test_output[start:end].strip()[:limit]
+    
+    @traced('llm', 'llm_chat', attrs=lambda stage, provider, provider_name, model_name, *rest: {"stage": stage, "provider": provider_name, "model": model_name})
+    def _timed_chat(self, stage: str, provider, provider_name: str, model_name: str,
+                    messages: List[Dict[str, str]]) -> str:
+        """Send a chat history to a provider, recording latency, tokens and cost for the stage"""
+        prompt_tokens = sum(estimate_tokens(message["content"]) for message in messages)
+        start = time.perf_counter()
+        try:
+            with self._admitted(provider, provider_name, prompt_tokens):
+                if hasattr(provider, 'chat'):
+                    response = provider.chat(messages)
+                else:
+                    response = provider.generate_response(*flatten_messages(messages))
+        except Exception:
+            self.metrics.record_call(stage, provider_name, model_name, time.perf_counter() - start,
+                                     prompt_tokens, 0, ok=False)
+            raise
+        latency = time.perf_counter() - start
+        self.router.observe_model(model_name, latency)
+        self.metrics.record_call(stage, provider_name, model_name, latency, prompt_tokens, estimate_tokens(response))
+        self.tracer.annotate(prompt_tokens=prompt_tokens, completion_tokens=estimate_tokens(response),
+                             messages=len(messages))
+        return response
+    
+    def _create_build_fix_prompt(self, build_output: str, config: Dict[str, Any],
+                                 test_file: Optional[Path] = None, test_content: str = "") -> str:
+        """Create prompt for build fix"""
+        instructions = config['instructions']
+        
+        request = "Please analyze the build errors below and provide specific fixes following the response structure."
+        file_section = ""
+        if test_file is not None:
+            request = "Fix the build errors below in this test file. Reply with the complete corrected file only."
+            file_section = f"""
+Test File: {test_file.name}
+Current Test Content:
+```cpp
+{test_content}
 ```
+"""
+        
+        prompt = f"""
+{instructions['objective']}
 
 Analysis Steps:
 {chr(10).join(f"- {step}" for step in instructions['analysis_steps'])}
@@ -533,10 +1932,19 @@ Analysis Steps:
 Fix Priorities:
 {chr(10).join(f"{i}. {priority}" for i, priority in enumerate(instructions['fix_priorities'], 1))}
 
-Please analyze the build errors and provide specific fixes following the response structure.
+Constraints:
+{chr(10).join(f"- {constraint}" for constraint in instructions.get('constraints', []))}
+
+{request}
+{file_section}
+Build Output/Errors:
+```
+{build_output}
+```
 """
         return prompt
     
+    @traced('stage')
     def run_coverage_analysis(self) -> Dict[str, Any]:
         """Run code coverage analysis on tests"""
         logger.info("Running coverage analysis...")
@@ -549,13 +1957,15 @@ Please analyze the build errors and provide specific fixes following the respons
         try:
             # Run tests with coverage
             test_cmd = ["./run_tests"]
-            test_result = subprocess.run(
-                test_cmd,
-                cwd=build_dir,
-                capture_output=True,
-                text=True,
-                timeout=300
-            )
+            with self.tracer.span("run_tests", "test", files="all"):
+                test_result = subprocess.run(
+                    test_cmd,
+                    cwd=build_dir,
+                    capture_output=True,
+                    text=True,
+                    timeout=300
+                )
+                self.tracer.annotate(returncode=test_result.returncode)
             
             # Generate coverage report (simplified)
             coverage_info = {
@@ -565,12 +1975,24 @@ Please analyze the build errors and provide specific fixes following the respons
             }
             
             logger.info(f"Tests {'passed' if coverage_info['test_success'] else 'failed'}")
+            self._checkpoint_passed(test_result.stdout)
             return coverage_info
             
         except Exception as e:
             logger.error(f"Coverage analysis error: {e}")
             return {}
     
+    def _checkpoint_passed(self, test_output: str):
+        """Mark test files none of whose tests failed in this run as passed"""
+        failed = set(FAILED_TEST_PATTERN.findall(test_output))
+        passed = []
+        for test_file in self.output_dir.glob("test_*.cpp"):
+            names = {block.full_name for block in extract_test_blocks(self.read_file_content(test_file))}
+            if names and not names & failed:
+                passed.append(test_file.name)
+        self.checkpoint.mark_all(passed, 'passed')
+    
+    @traced('stage')
     def improve_coverage(self, coverage_info: Dict[str, Any]) -> bool:
         """Improve test coverage based on analysis"""
         logger.info("Improving test coverage...")
@@ -580,18 +2002,30 @@ Please analyze the build errors and provide specific fixes following the respons
             logger.error("Failed to load coverage improvement config")
             return False
         
+        # New tests accumulate in one file as edit operations on top of what is already there
+        improvements_file = self.output_dir / "coverage_improvements.cpp"
+        current = self.read_file_content(improvements_file) if improvements_file.is_file() else ""
+        if not current.strip():
+            current = "#include <gtest/gtest.h>\n#include <gmock/gmock.h>\n"
+        
         # Create improvement prompt
-        prompt = self._create_coverage_improvement_prompt(coverage_info, config)
+        prompt = self._create_coverage_improvement_prompt(coverage_info, config, current)
         system_prompt = config['instructions']['role']
         
         try:
             # Get coverage improvements from LLM
-            improvements = self.llm_provider.generate_response(prompt, system_prompt)
+            improvements = self._generate_gated(improvements_file.name, prompt, system_prompt,
+                                                stage='coverage_improvement', edit_base=current)
+            if improvements is None:
+                logger.warning("No usable coverage improvements generated")
+                # Quarantined output is an answer too; a resumed run would only ask the same question again
+                self.checkpoint.complete_step('coverage')
+                return False
             
             # Save improvements to a new file
-            improvements_file = self.output_dir / "coverage_improvements.cpp"
-            with open(improvements_file, 'w', encoding='utf-8') as f:
-                f.write(improvements)
+            write_atomic(improvements_file, improvements)
+            self._end_fix_session(improvements_file.name)
+            self.checkpoint.complete_step('coverage')
             
             logger.info(f"Coverage improvements saved to: {improvements_file}")
             return True
@@ -600,18 +2034,14 @@ Please analyze the build errors and provide specific fixes following the respons
             logger.error(f"Error improving coverage: {e}")
             return False
     
-    def _create_coverage_improvement_prompt(self, coverage_info: Dict[str, Any], config: Dict[str, Any]) -> str:
+    def _create_coverage_improvement_prompt(self, coverage_info: Dict[str, Any], config: Dict[str, Any],
+                                            current: str = "") -> str:
         """Create prompt for coverage improvement"""
         instructions = config['instructions']
         
         prompt = f"""
 {instructions['objective']}
 
-Current Coverage Information:
-- Test Success: {coverage_info.get('test_success', False)}
-- Test Output: {coverage_info.get('test_output', 'No output')}
-- Test Errors: {coverage_info.get('test_errors', 'No errors')}
-
 Coverage Analysis Tasks:
 {chr(10).join(f"- {task}" for task in instructions['coverage_analysis'])}
 
@@ -619,9 +2049,22 @@ Improvement Strategies:
 {chr(10).join(f"- {strategy}" for strategy in instructions['improvement_strategies'])}
 
 Please generate additional test methods to improve coverage.
+
+{instructions.get('edit_format', '')}
+
+Current Coverage Information:
+- Test Success: {coverage_info.get('test_success', False)}
+- Test Output: {coverage_info.get('test_output', 'No output')}
+- Test Errors: {coverage_info.get('test_errors', 'No errors')}
+
+Current File: coverage_improvements.cpp
+```cpp
+{current}
+```
 """
         return prompt
     
+    @traced('stage')
     def generate_report(self) -> str:
         """Generate a comprehensive report of the test generation process"""
         logger.info("Generating final report...")
@@ -647,6 +2090,9 @@ Please generate additional test methods to improve coverage.
 4. ✅ Coverage analysis performed
 5. ✅ Coverage improvements generated
 
+## Model Usage by Stage
+{self.metrics.render_markdown()}
+
 ## Recommendations
 - Review generated tests for accuracy
 - Run tests manually to verify functionality
@@ -665,15 +2111,120 @@ Generated on: {__import__('datetime').datetime.now().strftime('%Y-%m-%d %H:%M:%S
         report_file = self.output_dir / "test_generation_report.md"
         with open(report_file, 'w', encoding='utf-8') as f:
             f.write(report)
+        for provider_name, peak in self.admission.peaks().items():
+            self.metrics.increment(f"admission_peak_tokens_{provider_name}", peak)
+        self.metrics.write_json(self.output_dir / "metrics.json")
         
         logger.info(f"Report saved to: {report_file}")
         return report
     
+    @traced('test', attrs=lambda test_files=None, timeout=300: {"files": len(test_files) if test_files else "all"})
+    def run_tests(self, test_files: Optional[List[Path]] = None, timeout: int = 300) -> tuple[bool, str]:
+        """Run the built test binary, limited to the tests defined in test_files when given"""
+        build_dir = self.output_dir / "build"
+        if not (build_dir / "run_tests").exists():
+            return False, "Test executable not found"
+        command = ["./run_tests"]
+        if test_files:
+            names = [block.full_name for test_file in test_files
+                     for block in extract_test_blocks(self.read_file_content(test_file))]
+            # Parameterized instances are named Prefix/Suite.Test/N
+            command.append("--gtest_filter=" + ":".join(f"{name}:*/{name}/*" for name in names))
+        try:
+            result = subprocess.run(command, cwd=build_dir, capture_output=True, text=True, timeout=timeout)
+        except subprocess.TimeoutExpired:
+            self.tracer.error("Tests timed out")
+            return False, "Tests timed out"
+        self._checkpoint_passed(result.stdout)
+        return result.returncode == 0, result.stdout + "\n" + result.stderr
+    
+    def watch(self, debounce_s: float = 0.5):
+        """Regenerate, rebuild and rerun only the tests affected by each batch of saved sources, until interrupted"""
+        self.keep_warm()
+        self.warm_up_models()
+        scanner = self._scanner()
+        watcher = SourceWatcher(self.project_path, scanner.wanted, scanner.excluded)
+        logger.info(f"Watching {self.project_path} ({watcher.kind}); press Ctrl-C to stop")
+        
+        # Catch up with edits made while nobody was watching
+        self._process_changes(ChangeBatch(first_event=time.monotonic(), rescan=True))
+        try:
+            for batch in watcher.batches(debounce_s):
+                self._process_changes(batch)
+        except KeyboardInterrupt:
+            logger.info("Stopped watching")
+        finally:
+            watcher.close()
+    
+    def _process_changes(self, batch: ChangeBatch) -> Optional[Dict[str, Any]]:
+        """Handle one debounced batch of changes and report the save-to-result latency"""
+        cpp_files, graph = self._project_index()
+        manifest = self._load_manifest()
+        known = {cpp_file.resolve(): cpp_file for cpp_file in cpp_files}
+        candidates = cpp_files if batch.rescan else [known[path.resolve()] for path in batch.paths
+                                                     if path.resolve() in known]
+        # Saves that did not change the content (or touched files) cost nothing
+        edited = self._changed_files(candidates, manifest)
+        
+        removed = [key for key in manifest if not (self.project_path / key).exists()]
+        for key in removed:
+            test_file = manifest.pop(key).get("test_file")
+            if test_file:
+                (self.output_dir / test_file).unlink(missing_ok=True)
+                self._end_fix_session(test_file)
+        if removed:
+            self._save_manifest(manifest)
+        
+        affected = sorted(graph.dependents(edited))
+        if not affected and not removed:
+            return None
+        logger.info(f"{len(edited)} sources changed, regenerating {len(affected)} tests"
+                    + (f", removed {len(removed)}" if removed else ""))
+        
+        generated = self.generate_initial_tests(only=affected) if affected else True
+        built, build_output = self.build_tests()
+        if not built:
+            built = self.fix_build_issues(build_output)
+        test_files = [self._test_file_for(cpp_file) for cpp_file in affected
+                      if self._test_file_for(cpp_file).is_file()]
+        passed, _ = self.run_tests(test_files) if built and test_files else (built, "")
+        
+        latency = time.monotonic() - batch.first_event
+        self.metrics.increment("watch_batches")
+        self.metrics.increment("watch_latency_seconds", latency)
+        summary = {
+            "time": time.time(),
+            "changed": [self._manifest_key(cpp_file) for cpp_file in edited],
+            "removed": removed,
+            "regenerated": [test_file.name for test_file in test_files],
+            "generated": generated,
+            "built": built,
+            "passed": passed,
+            "latency_s": round(latency, 3),
+        }
+        with open(self.output_dir / "watch_latency.jsonl", 'a', encoding='utf-8') as f:
+            f.write(json.dumps(summary) + "\n")
+        logger.info(f"Save to result in {latency:.2f}s: {len(test_files)} tests regenerated, "
+                    f"build {'ok' if built else 'failed'}, tests {'passed' if passed else 'failed'}")
+        return summary
+    
+    def _resumable(self, stage: str) -> bool:
+        """True when resuming and every generated test file has reached stage"""
+        test_files = list(self.output_dir.glob("test_*.cpp"))
+        return self.config.resume and bool(test_files) and \
+            all(self.checkpoint.reached(test_file.name, stage) for test_file in test_files)
+    
+    @traced('pipeline')
     def run_full_pipeline(self) -> bool:
         """Run the complete test generation pipeline"""
         logger.info("Starting full test generation pipeline...")
+        self.tracer.annotate(project=str(self.project_path), provider=self.config.model_provider,
+                             model=self.config.model_name, jobs=self.config.jobs, workers=self.config.workers)
         
         try:
+            # Step 0: Load models once so no stage pays for a cold start
+            self.warm_up_models()
+            
             # Step 1: Generate initial tests
             if not self.generate_initial_tests():
                 logger.error("Initial test generation failed")
@@ -683,17 +2234,26 @@ Generated on: {__import__('datetime').datetime.now().strftime('%Y-%m-%d %H:%M:%S
             if not self.refine_tests():
                 logger.warning("Test refinement failed, continuing with original tests")
             
-            # Step 3: Build tests
-            build_success, build_output = self.build_tests()
-            if not build_success:
-                logger.warning("Build failed, attempting to fix...")
-                if not self.fix_build_issues(build_output):
-                    logger.error("Could not fix build issues automatically")
+            # Step 3: Build tests, unless the journal shows every test file already compiled
+            if self._resumable('compiled') and (self.output_dir / "build" / "run_tests").exists():
+                logger.info("Resuming: all test files already compiled, skipping build")
+            else:
+                build_success, build_output = self.build_tests()
+                if not build_success:
+                    logger.warning("Build failed, attempting to fix...")
+                    if not self.fix_build_issues(build_output):
+                        logger.error("Could not fix build issues automatically")
             
-            # Step 4: Coverage analysis
-            coverage_info = self.run_coverage_analysis()
-            if coverage_info:
-                self.improve_coverage(coverage_info)
+            # Step 4: Coverage analysis; failing tests are regenerated one by one and rerun once
+            if self.config.resume and self.checkpoint.step_done('coverage'):
+                logger.info("Resuming: coverage step already completed")
+            else:
+                coverage_info = self.run_coverage_analysis()
+                if coverage_info and not coverage_info.get('test_success') \
+                        and self.fix_failing_tests(coverage_info.get('test_output', '')) and self.build_tests()[0]:
+                    coverage_info = self.run_coverage_analysis()
+                if coverage_info:
+                    self.improve_coverage(coverage_info)
             
             # Step 5: Generate report
             self.generate_report()
@@ -705,51 +2265,336 @@ Generated on: {__import__('datetime').datetime.now().strftime('%Y-%m-%d %H:%M:%S
             logger.error(f"Pipeline failed: {e}")
             return False
 
-def main():
-    """Main entry point"""
+def worker_main(argv: List[str]):
+    """`test_generator.py worker`: generate tests for jobs leased from a coordinator's queue"""
+    parser = argparse.ArgumentParser(prog="test_generator.py worker",
+                                     description="Pull generation jobs from a pipeline's SQLite job queue")
+    parser.add_argument("--queue", required=True, help=f"Queue database, <output-dir>/{QUEUE_NAME}")
+    parser.add_argument("--name", help="Worker name (default host:pid)")
+    parser.add_argument("--wait", type=float, default=60.0,
+                        help="Seconds to wait for the coordinator to publish its config before giving up")
+    args = parser.parse_args(argv)
+    
+    # Opening a missing path would create an empty queue that no coordinator ever fills
+    if not Path(args.queue).is_file():
+        logger.error(f"Job queue not found: {args.queue}")
+        sys.exit(1)
+    queue = JobQueue(Path(args.queue))
+    deadline = time.monotonic() + args.wait
+    while queue.meta('config') is None:
+        if time.monotonic() >= deadline:
+            logger.error(f"No coordinator config in {args.queue} after {args.wait:g}s; is it a pipeline's job queue?")
+            queue.close()
+            sys.exit(1)
+        time.sleep(WORKER_POLL_S)
+    name = args.name or worker_name()
+    config = GeneratorConfig(**queue.meta('config'))
+    if config.trace:
+        # One trace per worker process next to the coordinator's; timestamps are wall-clock, so they line up
+        trace = Path(config.trace)
+        config = replace(config, trace=str(trace.with_name(f"{trace.stem}.worker-{os.getpid()}{trace.suffix}")))
+    generator = CppTestGenerator(config)
+    try:
+        completed = generator.work(queue, name)
+        logger.info(f"Worker {name} completed {completed} jobs")
+    finally:
+        generator.tracer.close()
+        queue.close()
+
+def merge_main(argv: List[str]):
+    """`test_generator.py merge`: combine the output directories of --shard runs into one"""
+    parser = argparse.ArgumentParser(prog="test_generator.py merge",
+                                     description="Merge per-shard output directories into one output and report")
+    parser.add_argument("--output-dir", required=True, help="Merged output directory")
+    parser.add_argument("--project-path", help="Project path for the report (default: from the shards)")
+    parser.add_argument("shard_dirs", nargs="+", help="Output directories of the shard runs")
+    args = parser.parse_args(argv)
+    
+    shard_dirs = [Path(shard_dir) for shard_dir in args.shard_dirs]
+    missing = [str(shard_dir) for shard_dir in shard_dirs if not shard_dir.is_dir()]
+    if missing:
+        logger.error(f"Shard output directories not found: {', '.join(missing)}")
+        sys.exit(1)
+    info: Dict[str, Any] = {}
+    for shard_dir in shard_dirs:
+        if (shard_dir / SHARD_INFO_NAME).is_file():
+            info = json.loads((shard_dir / SHARD_INFO_NAME).read_text(encoding='utf-8'))
+            break
+    
+    # The merged report only needs paths and model names, so no provider is created
+    config = GeneratorConfig(project_path=args.project_path or info.get("project_path", "."),
+                             output_dir=args.output_dir, model_provider='mock',
+                             model_name=info.get("model_name", "unknown"))
+    generator = CppTestGenerator(config)
+    generator.config = replace(config, model_provider=info.get("model_provider", "unknown"))
+    
+    counts = merge_shard_outputs(shard_dirs, generator.output_dir, generator.manifest_path.name)
+    for shard_dir in shard_dirs:
+        if (shard_dir / "metrics.json").is_file():
+            generator.metrics.merge(json.loads((shard_dir / "metrics.json").read_text(encoding='utf-8')))
+    for name, value in counts.items():
+        generator.metrics.increment(name, value)
+    generator.generate_report()
+    logger.info(f"Merged {len(shard_dirs)} shards into {generator.output_dir}: {counts['merged_test_files']} test files")
+
+def register_rpc_methods(server: RpcServer, generator: CppTestGenerator):
+    """Expose the pipeline steps of a warm generator; steps run one at a time, status and shutdown never wait"""
+    def generate(files: Optional[List[str]] = None) -> Dict[str, Any]:
+        only = [Path(f) if Path(f).is_absolute() else generator.project_path / f for f in files] if files else None
+        ok = generator.generate_initial_tests(only)
+        targets = only or generator.find_cpp_files()
+        return {"ok": ok, "tests": [generator._test_file_for(f).name for f in targets
+                                    if generator._test_file_for(f).is_file()]}
+    
+    def build() -> Dict[str, Any]:
+        ok, output = generator.build_tests()
+        return {"ok": ok, "output": output[-4000:]}
+    
+    def coverage() -> Dict[str, Any]:
+        coverage_info = generator.run_coverage_analysis()
+        return {"ok": generator.improve_coverage(coverage_info) if coverage_info else False,
+                "test_success": coverage_info.get("test_success", False)}
+    
+    def status() -> Dict[str, Any]:
+        cache = generator.response_cache
+        return {
+            "project_path": str(generator.project_path),
+            "indexed_files": len(generator._index[0]) if generator._index else 0,
+            "response_cache": {"entries": len(cache), "hits": cache.hits, "misses": cache.misses} if cache else None,
+            "checkpoint": generator.checkpoint.counts(),
+            "counters": generator.metrics.to_dict()["counters"],
+        }
+    
+    def shutdown() -> bool:
+        server.shutdown()
+        return True
+    
+    server.register("generate", generate)
+    server.register("refine", generator.refine_tests)
+    server.register("build", build)
+    server.register("coverage", coverage)
+    server.register("report", generator.generate_report)
+    server.register("status", status, exclusive=False)
+    server.register("shutdown", shutdown, exclusive=False)
+
+def serve_main(argv: List[str]):
+    """`test_generator.py serve`: keep a warm generator behind a local JSON-RPC socket"""
+    parser = build_parser()
+    parser.prog = "test_generator.py serve"
+    parser.add_argument("--socket", help=f"Unix socket to listen on (default <output-dir>/{SOCKET_NAME})")
+    args = parser.parse_args(argv)
+    
+    generator = CppTestGenerator(config_from_args(parser, args))
+    generator.keep_warm()
+    generator.warm_up_models()
+    server = RpcServer(Path(args.socket) if args.socket else generator.output_dir / SOCKET_NAME)
+    register_rpc_methods(server, generator)
+    try:
+        server.serve_forever()
+    except AlreadyServing as e:
+        logger.error(f"{e}; stop it with 'test_generator.py call shutdown' or pick another --socket")
+        sys.exit(1)
+    finally:
+        generator.tracer.close()
+
+def call_main(argv: List[str]):
+    """`test_generator.py call`: send one request to a running serve process and print its result"""
+    parser = argparse.ArgumentParser(prog="test_generator.py call", description="Call a running generator daemon")
+    parser.add_argument("method", help="generate, refine, build, coverage, report, status or shutdown")
+    parser.add_argument("--params", default="{}", help='JSON object, e.g. \'{"files": ["src/a.cc"]}\'')
+    target = parser.add_mutually_exclusive_group(required=True)
+    target.add_argument("--socket", help="Socket of the serve process")
+    target.add_argument("--output-dir", help=f"Output directory of the serve process (uses its {SOCKET_NAME})")
+    args = parser.parse_args(argv)
+    
+    socket_path = Path(args.socket) if args.socket else Path(args.output_dir) / SOCKET_NAME
+    try:
+        result = rpc_call(socket_path, args.method, json.loads(args.params))
+    except (RpcError, OSError, ValueError) as e:
+        print(json.dumps({"error": str(e)}), file=sys.stderr)
+        sys.exit(1)
+    print(json.dumps(result, indent=2))
+
+def build_parser() -> argparse.ArgumentParser:
+    """Arguments shared by a pipeline run and serve mode"""
     parser = argparse.ArgumentParser(description="C++ Unit Test Generator using AI Models")
     
     parser.add_argument("--project-path", required=True, help="Path to C++ project")
     parser.add_argument("--output-dir", required=True, help="Output directory for generated tests")
     parser.add_argument("--provider", choices=['ollama', 'github', 'gemini'], default='ollama', help="LLM provider")
-    parser.add_argument("--model", default='llama3.2:latest', help="Model name")
+    parser.add_argument("--model", help="Model name (default: llama3.2:latest); overrides the stage YAML models")
     parser.add_argument("--api-key", help="API key for external providers")
     parser.add_argument("--api-url", help="Custom API URL")
-    parser.add_argument("--temperature", type=float, default=0.2, help="Model temperature")
-    parser.add_argument("--max-tokens", type=int, default=4000, help="Maximum tokens")
+    parser.add_argument("--temperature", type=float,
+                        help="Model temperature (default: 0.2); overrides the stage YAML")
+    parser.add_argument("--max-tokens", type=int, help="Maximum tokens (default: 4000); overrides the stage YAML")
     parser.add_argument("--step", choices=['initial', 'refine', 'build', 'coverage', 'full'], 
                        default='full', help="Which step to run")
+    parser.add_argument("--incremental", action="store_true",
+                       help="Only regenerate tests for changed files and their transitive dependents")
+    parser.add_argument("--jobs", type=int, default=1, help="Concurrent generation requests per include layer")
+    parser.add_argument("--gate-retries", type=int, default=1,
+                       help="Re-prompts for output rejected by the local syntax gate before quarantining it")
+    parser.add_argument("--min-test-score", type=float, default=0.5,
+                       help="Minimum share of tests with real assertions on project code; lower scores are regenerated")
+    parser.add_argument("--no-stage-routing", action="store_true",
+                       help="Use the CLI provider/model/temperature for every stage instead of the YAML settings")
+    parser.add_argument("--candidates", type=int, default=1,
+                       help="Candidates sampled in parallel for hard files; the first that compiles is kept")
+    parser.add_argument("--candidate-model", action="append",
+                       help="Extra provider:model for the candidate pool, e.g. ollama:codellama:7b (repeatable)")
+    parser.add_argument("--hard-file-tokens", type=int, default=1500,
+                       help="Source size (estimated tokens) from which files go straight to best-of-N")
+    parser.add_argument("--build-fix-rounds", type=int, default=3,
+                       help="Rebuild/repair iterations; later rounds only send each file's new diagnostics")
+    parser.add_argument("--no-structured-output", action="store_true",
+                       help="Ask for whole test files instead of JSON test records assembled locally")
+    parser.add_argument("--no-coalesce", action="store_true",
+                       help="Send identical concurrent prompts separately instead of sharing one call")
+    parser.add_argument("--token-budget", action="append", metavar="PROVIDER=TOKENS",
+                       help="In-flight token budget (prompt + max_tokens) per provider, e.g. ollama=16000 (repeatable)")
+    parser.add_argument("--chunk-tokens", type=int,
+                       help="Split sources larger than this (estimated tokens) at class/function boundaries "
+                            "and generate chunks in parallel; default max-tokens, 0 disables")
+    parser.add_argument("--exclude", action="append", metavar="GLOB",
+                       help="Skip files/directories matching this glob (name, or project-relative path if it "
+                            "contains '/'); adds to the built-in list, '!GLOB' scans a built-in exclusion again (repeatable)")
+    parser.add_argument("--no-gitignore", action="store_true", help="Scan files ignored by .gitignore too")
+    parser.add_argument("--keep-alive", default="30m",
+                       help="How long Ollama keeps models loaded between requests (e.g. 30m, 1h, -1 for forever)")
+    parser.add_argument("--max-context", type=int, default=32768,
+                       help="Upper bound for the num_ctx sized per Ollama request from the prompt length")
+    parser.add_argument("--workers", type=int, default=0,
+                       help="Generate in this many worker processes fed by an SQLite job queue; more can join "
+                            "with 'test_generator.py worker --queue <output-dir>/.job_queue.db'")
+    parser.add_argument("--shard", metavar="I/N",
+                       help="Generate only shard I of N (1-based), split by a stable hash balanced on source "
+                            "size; combine shard outputs with 'test_generator.py merge'")
+    parser.add_argument("--watch", action="store_true",
+                       help="After catching up, watch the project and regenerate, rebuild and rerun only the tests "
+                            "affected by each save")
+    parser.add_argument("--debounce", type=float, default=0.5,
+                       help="Seconds of quiet after a save before --watch regenerates")
+    parser.add_argument("--resume", action="store_true",
+                       help="Continue an interrupted run from the checkpoint journal in the output directory")
+    parser.add_argument("--record", metavar="CASSETTE",
+                       help="Append every model request, response and latency to this gzip JSONL cassette")
+    parser.add_argument("--replay", metavar="CASSETTE",
+                       help="Answer model requests from a recorded cassette instead of calling the provider")
+    parser.add_argument("--replay-speed", type=float, default=1.0,
+                       help="Divide recorded latencies by this when replaying; 0 answers instantly")
+    parser.add_argument("--trace", metavar="FILE",
+                       help="Write pipeline, stage, file, model call, compile and test spans here; a .json file "
+                            "is a Chrome trace for Perfetto, anything else JSONL")
+    parser.add_argument("--mock-include-dir", action="append",
+                       help="Include dir searched for Drogon headers when generating shared mocks (repeatable)")
     
-    args = parser.parse_args()
+    return parser
+
+def config_from_args(parser: argparse.ArgumentParser, args: argparse.Namespace) -> GeneratorConfig:
+    if args.shard:
+        try:
+            parse_shard(args.shard)
+        except ValueError as e:
+            parser.error(str(e))
+    for flag, value in (('--gate-retries', args.gate_retries), ('--build-fix-rounds', args.build_fix_rounds),
+                        ('--debounce', args.debounce), ('--workers', args.workers),
+                        ('--replay-speed', args.replay_speed), ('--hard-file-tokens', args.hard_file_tokens),
+                        ('--chunk-tokens', args.chunk_tokens)):
+        if value is not None and value < 0:
+            parser.error(f"{flag} must not be negative, got {value}")
+    for flag, value in (('--jobs', args.jobs), ('--max-context', args.max_context), ('--max-tokens', args.max_tokens)):
+        if value is not None and value < 1:
+            parser.error(f"{flag} must be at least 1, got {value}")
+    if args.candidates < 1:
+        parser.error(f"--candidates must be at least 1, got {args.candidates}")
+    if not 0 <= args.min_test_score <= 1:
+        parser.error(f"--min-test-score must be between 0 and 1, got {args.min_test_score}")
+    token_budgets = {}
+    for entry in args.token_budget or []:
+        name, _, tokens = entry.partition('=')
+        if not name or not tokens.strip().isdigit():
+            parser.error(f"--token-budget must look like provider=tokens, e.g. ollama=16000, got {entry!r}")
+        token_budgets[name] = int(tokens)
+    if args.record and args.replay:
+        parser.error("--record and --replay cannot be combined")
+    if args.replay and not Path(args.replay).is_file():
+        parser.error(f"Cassette not found: {args.replay}")
     
-    # Create configuration
-    config = GeneratorConfig(
+    return GeneratorConfig(
         project_path=args.project_path,
         output_dir=args.output_dir,
         model_provider=args.provider,
-        model_name=args.model,
+        model_name=args.model or 'llama3.2:latest',
         api_key=args.api_key,
         api_url=args.api_url,
-        temperature=args.temperature,
-        max_tokens=args.max_tokens
+        temperature=0.2 if args.temperature is None else args.temperature,
+        max_tokens=4000 if args.max_tokens is None else args.max_tokens,
+        cli_settings=[name for name, value in (('model_name', args.model), ('temperature', args.temperature),
+                                               ('max_tokens', args.max_tokens)) if value is not None],
+        incremental=args.incremental,
+        gate_retries=args.gate_retries,
+        min_test_score=args.min_test_score,
+        stage_routing=not args.no_stage_routing,
+        candidates=args.candidates,
+        candidate_models=args.candidate_model,
+        hard_file_tokens=args.hard_file_tokens,
+        build_fix_rounds=args.build_fix_rounds,
+        structured_output=not args.no_structured_output,
+        coalesce=not args.no_coalesce,
+        chunk_tokens=args.chunk_tokens,
+        exclude_globs=args.exclude,
+        respect_gitignore=not args.no_gitignore,
+        token_budgets=token_budgets,
+        keep_alive=args.keep_alive,
+        max_context=args.max_context,
+        resume=args.resume,
+        workers=args.workers,
+        shard=args.shard,
+        record=args.record,
+        replay=args.replay,
+        replay_speed=args.replay_speed,
+        trace=args.trace,
+        jobs=args.jobs,
+        mock_include_dirs=args.mock_include_dir
     )
+
+def main():
+    """Main entry point"""
+    commands = {"worker": worker_main, "merge": merge_main, "serve": serve_main, "call": call_main}
+    if sys.argv[1:2] and sys.argv[1] in commands:
+        commands[sys.argv[1]](sys.argv[2:])
+        return
+    
+    parser = build_parser()
+    args = parser.parse_args()
     
     # Create generator
-    generator = CppTestGenerator(config)
+    generator = CppTestGenerator(config_from_args(parser, args))
     
-    # Run specified step
+    # Every exit path closes the tracer, or a Chrome trace is left without its closing bracket
     success = False
-    if args.step == 'initial':
-        success = generator.generate_initial_tests()
-    elif args.step == 'refine':
-        success = generator.refine_tests()
-    elif args.step == 'build':
-        success, _ = generator.build_tests()
-    elif args.step == 'coverage':
-        coverage_info = generator.run_coverage_analysis()
-        success = generator.improve_coverage(coverage_info)
-    elif args.step == 'full':
-        success = generator.run_full_pipeline()
+    try:
+        if args.watch:
+            generator.watch(args.debounce)
+            return
+        
+        # Run specified step
+        if args.step in ('initial', 'refine', 'coverage'):
+            generator.warm_up_models()
+        if args.step == 'initial':
+            success = generator.generate_initial_tests()
+        elif args.step == 'refine':
+            success = generator.refine_tests()
+        elif args.step == 'build':
+            success, _ = generator.build_tests()
+        elif args.step == 'coverage':
+            coverage_info = generator.run_coverage_analysis()
+            success = generator.improve_coverage(coverage_info)
+        elif args.step == 'full':
+            success = generator.run_full_pipeline()
+    finally:
+        generator.tracer.close()
     
     if success:
         logger.info("Operation completed successfully")
@@ -0,0 +1,147 @@
+"""
+Local quality scoring of generated tests
+Detects placeholder tests (no real assertions, no project code exercised) so they
+are regenerated instead of being compiled and run
+"""
+
+import re
+from dataclasses import dataclass, field
+from typing import Iterable, List, Set
+
+from output_gate import WHOLE_FILE_ANSWER, strip_comments_and_literals
+
+TEST_HEADER_PATTERN = re.compile(r'^[ \t]*(TEST|TEST_F|TEST_P)\s*\(\s*(\w+)\s*,\s*(\w+)\s*\)\s*\{', re.MULTILINE)
+ASSERTION_PATTERN = re.compile(r'\b(?:EXPECT|ASSERT)_(\w+)\s*\(')
+IDENTIFIER_PATTERN = re.compile(r'\b[A-Za-z_]\w*\b')
+LITERAL_ARG_PATTERN = re.compile(r'^\s*(?:true|false|nullptr|NULL|-?\d+(?:\.\d+)?[fFuUlL]*|"[^"]*"|\'[^\']*\'|)\s*$')
+
+# Identifiers in source files that say nothing about what a test exercises
+IGNORED_SYMBOLS = {
+    'include', 'define', 'pragma', 'once', 'ifndef', 'endif', 'namespace', 'using', 'class', 'struct',
+    'public', 'private', 'protected', 'virtual', 'override', 'const', 'static', 'inline', 'return',
+    'void', 'bool', 'int', 'long', 'double', 'float', 'char', 'auto', 'unsigned', 'std', 'string',
+    'vector', 'map', 'shared_ptr', 'unique_ptr', 'make_shared', 'function', 'optional', 'size_t',
+    'true', 'false', 'nullptr', 'this', 'new', 'delete', 'if', 'else', 'for', 'while', 'switch',
+    'case', 'break', 'continue', 'try', 'catch', 'throw', 'template', 'typename', 'explicit',
+    'default', 'noexcept', 'enum', 'typedef', 'friend', 'operator', 'sizeof', 'Json', 'Value',
+    'drogon', 'orm', 'org_chart', 'drogon_model',
+}
+
+
+@dataclass
+class TestBlock:
+    """One TEST/TEST_F/TEST_P definition located in a test file"""
+    macro: str
+    suite: str
+    name: str
+    start: int  # offset of the macro
+    end: int  # offset just past the closing brace
+    body: str  # comment/literal-stripped body text
+
+    @property
+    def full_name(self) -> str:
+        return f"{self.suite}.{self.name}"
+
+
+@dataclass
+class QualityReport:
+    """Per-file verdict from the trivial-test detector"""
+    total: int = 0
+    meaningful: List[str] = field(default_factory=list)
+    trivial: List[str] = field(default_factory=list)
+    reasons: List[str] = field(default_factory=list)
+
+    @property
+    def score(self) -> float:
+        return len(self.meaningful) / self.total if self.total else 0.0
+
+
+def extract_test_blocks(content: str) -> List[TestBlock]:
+    """Locate every test definition and its body using a comment/literal-blind brace scan"""
+    code = strip_comments_and_literals(content)
+    blocks = []
+    for match in TEST_HEADER_PATTERN.finditer(code):
+        depth = 0
+        for index in range(match.end() - 1, len(code)):
+            if code[index] == '{':
+                depth += 1
+            elif code[index] == '}':
+                depth -= 1
+                if depth == 0:
+                    blocks.append(TestBlock(match.group(1), match.group(2), match.group(3),
+                                            match.start(), index + 1, code[match.end():index]))
+                    break
+    return blocks
+
+
+def project_symbols(source_code: str) -> Set[str]:
+    """Identifiers a test of this source could meaningfully call or construct"""
+    code = strip_comments_and_literals(source_code)
+    code = re.sub(r'^\s*#.*$', '', code, flags=re.MULTILINE)
+    return {name for name in IDENTIFIER_PATTERN.findall(code)
+            if len(name) > 2 and name not in IGNORED_SYMBOLS}
+
+
+def _assertion_args(body: str, open_index: int) -> str:
+    depth = 0
+    for index in range(open_index, len(body)):
+        if body[index] == '(':
+            depth += 1
+        elif body[index] == ')':
+            depth -= 1
+            if depth == 0:
+                return body[open_index + 1:index]
+    return body[open_index + 1:]
+
+
+def has_real_assertion(body: str) -> bool:
+    """True when the body checks something other than a constant"""
+    if re.search(r'\bEXPECT_CALL\s*\(', body):
+        return True
+    for match in ASSERTION_PATTERN.finditer(body):
+        args = _assertion_args(body, match.end() - 1)
+        # EXPECT_TRUE(true), EXPECT_EQ(1, 1), SUCCEED-style placeholders
+        if not all(LITERAL_ARG_PATTERN.match(arg) for arg in args.split(',')):
+            return True
+    return False
+
+
+def score_tests(content: str, symbols: Iterable[str] = ()) -> QualityReport:
+    """Classify each test as meaningful or trivial"""
+    symbols = set(symbols)
+    report = QualityReport()
+    for block in extract_test_blocks(content):
+        report.total += 1
+        problems = []
+        if not has_real_assertion(block.body):
+            problems.append("no real assertion")
+        if symbols and not symbols.intersection(IDENTIFIER_PATTERN.findall(block.body)):
+            problems.append("exercises no project code")
+        if problems:
+            report.trivial.append(block.full_name)
+            report.reasons.append(f"{block.full_name}: {', '.join(problems)}")
+        else:
+            report.meaningful.append(block.full_name)
+    return report
+
+
+def drop_tests(content: str, full_names: Iterable[str]) -> str:
+    """Remove the named tests from a file, leaving everything else untouched"""
+    doomed = set(full_names)
+    pieces, cursor = [], 0
+    for block in extract_test_blocks(content):
+        if block.full_name in doomed:
+            pieces.append(content[cursor:block.start])
+            cursor = block.end
+    pieces.append(content[cursor:])
+    return re.sub(r'\n{3,}', '\n\n', "".join(pieces))
+
+
+def quality_retry_instructions(report: QualityReport, answer: str = WHOLE_FILE_ANSWER) -> str:
+    """Prompt suffix naming the placeholder tests to replace, answering in the stage's format"""
+    return (
+        "\n\nYour previous answer contained placeholder tests:\n"
+        + "\n".join(f"- {reason}" for reason in report.reasons)
+        + "\nEvery test must call the code under test and assert on its observable result."
+        f" Return {answer}."
+    )
@@ -0,0 +1,188 @@
+"""
+Structured test-case records
+Initial generation asks for JSON records (includes, fixtures, one entry per test)
+and assembles the test file locally; a test that fails to compile or run is later
+regenerated on its own and spliced back into the file
+"""
+
+import re
+import json
+import textwrap
+from pathlib import Path
+from dataclasses import dataclass, field
+from typing import Any, Callable, Dict, Iterable, List, Optional, Set, Tuple
+
+from checkpoint import write_atomic
+from output_gate import sanitize
+from test_quality import TestBlock, extract_test_blocks
+
+JSON_FENCE_PATTERN = re.compile(r'^```[ \t]*(?:json)?[ \t]*\n(.*?)^```[ \t]*$', re.MULTILINE | re.DOTALL)
+REQUIRED_INCLUDES = ('<gtest/gtest.h>', '<gmock/gmock.h>')
+
+# What a retry asks for when initial generation expects test records
+RECORDS_ANSWER = "only the JSON test records in the response format described above, not a C++ file"
+
+
+@dataclass
+class TestRecord:
+    """One test case as returned by the model"""
+    fixture: str
+    name: str
+    body: str
+    macro: str = "TEST"
+
+
+@dataclass
+class TestFileRecord:
+    """Everything needed to assemble one test file"""
+    includes: List[str] = field(default_factory=list)
+    fixtures: str = ""
+    tests: List[TestRecord] = field(default_factory=list)
+
+
+def _identifier(value: Any) -> str:
+    return re.sub(r'\W', '_', str(value).strip()) or "Unnamed"
+
+
+def _include(value: str) -> str:
+    value = re.sub(r'^\s*#\s*include\s*', '', str(value)).strip()
+    return value if value[:1] in ('<', '"') else f'"{value}"'
+
+
+def _load_json(text: str) -> Optional[Any]:
+    candidates = JSON_FENCE_PATTERN.findall(text) + [text.strip()]
+    start, end = text.find('{'), text.rfind('}')
+    if 0 <= start < end:
+        candidates.append(text[start:end + 1])
+    for candidate in candidates:
+        try:
+            return json.loads(candidate)
+        except ValueError:
+            continue
+    return None
+
+
+def parse_test_records(text: str) -> Optional[TestFileRecord]:
+    """Read the JSON test records in a response, or None when the model answered with a plain file"""
+    data = _load_json(text)
+    if not isinstance(data, dict) or not isinstance(data.get('tests'), list):
+        return None
+
+    fixtures = str(data.get('fixtures') or "").strip()
+    fixture_classes = set(re.findall(r'\b(?:class|struct)\s+(\w+)', fixtures))
+    record = TestFileRecord([_include(i) for i in data.get('includes') or []], fixtures)
+    for entry in data['tests']:
+        if not isinstance(entry, dict) or not entry.get('name'):
+            continue
+        fixture = _identifier(entry.get('fixture') or entry.get('suite') or "GeneratedTest")
+        macro = entry.get('macro') if entry.get('macro') in ('TEST', 'TEST_F', 'TEST_P') else \
+            ('TEST_F' if fixture in fixture_classes else 'TEST')
+        record.tests.append(TestRecord(fixture, _identifier(entry['name']), str(entry.get('body') or ""), macro))
+    return record if record.tests else None
+
+
+def _indent_body(body: str) -> str:
+    return textwrap.indent(textwrap.dedent(body).strip('\n'), "    ")
+
+
+def render_test(test: TestRecord) -> str:
+    return f"{test.macro}({test.fixture}, {test.name}) {{\n{_indent_body(test.body)}\n}}"
+
+
+def assemble(record: TestFileRecord) -> str:
+    """Render a complete gtest file from its records"""
+    includes = [i for i in REQUIRED_INCLUDES if i not in record.includes] + record.includes
+    parts = ["\n".join(f"#include {include}" for include in dict.fromkeys(includes))]
+    if record.fixtures:
+        parts.append(record.fixtures)
+    parts.extend(render_test(test) for test in record.tests)
+    return "\n\n".join(parts) + "\n"
+
+
+def line_of(content: str, offset: int) -> int:
+    return content.count('\n', 0, offset) + 1
+
+
+def tests_at_lines(content: str, lines: Iterable[int]) -> Optional[List[TestBlock]]:
+    """Tests containing every given line; None when any line falls outside a test body"""
+    blocks = [(line_of(content, b.start), line_of(content, b.end), b) for b in extract_test_blocks(content)]
+    hit = []
+    for line in lines:
+        owner = next((block for first, last, block in blocks if first <= line <= last), None)
+        if owner is None:
+            return None
+        if owner not in hit:
+            hit.append(owner)
+    return hit
+
+
+def parse_test_body(text: str, full_name: str) -> Optional[str]:
+    """Body of a single regenerated test, from {"body": ...} JSON or a fenced TEST block"""
+    data = _load_json(text)
+    if isinstance(data, dict) and isinstance(data.get('body'), str):
+        return data['body']
+    code = sanitize(text)
+    blocks = extract_test_blocks(code)
+    match = next((b for b in blocks if b.full_name == full_name), blocks[0] if len(blocks) == 1 else None)
+    if match is None:
+        return None
+    return code[code.index('{', match.start) + 1:match.end - 1]
+
+
+def replace_test_body(content: str, full_name: str, body: str) -> Optional[str]:
+    """Splice a new body into the named test, keeping its macro, suite and name"""
+    block = next((b for b in extract_test_blocks(content) if b.full_name == full_name), None)
+    if block is None:
+        return None
+    header = content[block.start:content.index('{', block.start) + 1]
+    return content[:block.start] + f"{header}\n{_indent_body(body)}\n}}" + content[block.end:]
+
+
+def unique_name(name: str, taken: Callable[[str], bool]) -> str:
+    """name, else name with a number appended (2, 3, ...) until it is free"""
+    candidate, number = name, 1
+    while taken(candidate):
+        number += 1
+        candidate = f"{name}{number}"
+    return candidate
+
+
+def rename_tests(content: str, renames: Dict[int, str]) -> str:
+    """Give tests new names (block start offset -> new test name), keeping their macro, suite and body"""
+    pieces, last = [], 0
+    for block in extract_test_blocks(content):
+        if block.start not in renames:
+            continue
+        header_end = content.index('{', block.start)
+        pieces += [content[last:block.start], f"{block.macro}({block.suite}, {renames[block.start]}) "]
+        last = header_end
+    return "".join(pieces) + content[last:]
+
+
+def claim_test_names(content: str, taken: Set[str]) -> Tuple[str, Set[str], int]:
+    """Rename tests whose Suite.Name is in `taken` (or repeats within the file) by appending a number;
+    returns the content, the names it now defines and how many tests were renamed"""
+    renames: Dict[int, str] = {}
+    mine: Set[str] = set()
+    for block in extract_test_blocks(content):
+        name = unique_name(block.name, lambda name: f"{block.suite}.{name}" in taken
+                           or f"{block.suite}.{name}" in mine)
+        mine.add(f"{block.suite}.{name}")
+        if name != block.name:
+            renames[block.start] = name
+    return (rename_tests(content, renames) if renames else content), mine, len(renames)
+
+
+def dedupe_test_files(test_files: Iterable[Path]) -> int:
+    """Rename tests defined by more than one of the given files, in place; the first file in order
+    keeps the name. Returns how many tests were renamed"""
+    taken: Set[str] = set()
+    renamed = 0
+    for test_file in test_files:
+        content = test_file.read_text(encoding='utf-8', errors='replace')
+        claimed, mine, count = claim_test_names(content, taken)
+        taken |= mine
+        if count:
+            write_atomic(test_file, claimed)
+            renamed += count
+    return renamed
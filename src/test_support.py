@@ -0,0 +1,252 @@
+"""
+Shared test-support library for generated tests
+Response checkers, fixtures and model factories are emitted once into a static
+library instead of being re-defined (often inconsistently) in every test file
+"""
+
+import re
+import logging
+from pathlib import Path
+from typing import Dict, Iterable, List, Optional
+
+from mock_generator import iter_namespace_classes
+
+logger = logging.getLogger(__name__)
+
+TEST_SUPPORT_DIR = "test_support"
+TEST_SUPPORT_HEADER = "test_support.h"
+
+# Default column values for the Drogon ORM models of the orgChartApi schema
+MODEL_DEFAULTS: Dict[str, Dict[str, object]] = {
+    "Person": {"id": 1, "job_id": 1, "department_id": 1, "manager_id": 1,
+               "first_name": "Jane", "last_name": "Doe", "hire_date": "2020-01-01"},
+    "Department": {"id": 1, "name": "Engineering"},
+    "Job": {"id": 1, "title": "Software Engineer"},
+    "User": {"id": 1, "username": "testuser", "password": "password"},
+}
+
+SOURCE_SUFFIXES = ('.cc', '.cpp', '.cxx', '.c++')
+
+DROGON_DECLARATIONS = """// Fails the current test unless resp is non-null and carries the expected status
+void checkResponse(const drogon::HttpResponsePtr &resp, drogon::HttpStatusCode expected);
+
+// Parses the JSON body of a response; returns a null value when the body is not JSON
+Json::Value responseJson(const drogon::HttpResponsePtr &resp);
+
+// Builds a request with a JSON body, the way clients call the REST controllers
+drogon::HttpRequestPtr makeJsonRequest(const Json::Value &body, drogon::HttpMethod method = drogon::Post);
+
+// Fixture for controller tests: pass capture() as the handler callback, then inspect response
+class ControllerTest : public ::testing::Test {
+protected:
+    std::function<void(const drogon::HttpResponsePtr &)> capture();
+    drogon::HttpResponsePtr response;
+    int callbackCount = 0;
+};
+"""
+
+DROGON_DEFINITIONS = """void checkResponse(const drogon::HttpResponsePtr &resp, drogon::HttpStatusCode expected) {
+    ASSERT_NE(resp, nullptr);
+    EXPECT_EQ(resp->getStatusCode(), expected);
+}
+
+Json::Value responseJson(const drogon::HttpResponsePtr &resp) {
+    if (!resp || !resp->getJsonObject()) {
+        return Json::Value();
+    }
+    return *resp->getJsonObject();
+}
+
+drogon::HttpRequestPtr makeJsonRequest(const Json::Value &body, drogon::HttpMethod method) {
+    auto req = drogon::HttpRequest::newHttpJsonRequest(body);
+    req->setMethod(method);
+    return req;
+}
+
+std::function<void(const drogon::HttpResponsePtr &)> ControllerTest::capture() {
+    return [this](const drogon::HttpResponsePtr &resp) {
+        response = resp;
+        ++callbackCount;
+    };
+}
+"""
+
+ERR_RESP_DECLARATION = """// Same shape as the project's error responses: {"error": err}
+Json::Value makeErrResp(const std::string &err);
+"""
+
+ERR_RESP_DEFINITION = """Json::Value makeErrResp(const std::string &err) {
+    Json::Value ret;
+    ret["error"] = err;
+    return ret;
+}
+"""
+
+
+class TestSupportLibrary:
+    """Emits test_support.h/.cpp and the CMake fragment building them into a static library"""
+
+    def __init__(self, project_path: Path, output_dir: Path):
+        self.project_path = Path(project_path)
+        self.support_dir = Path(output_dir) / TEST_SUPPORT_DIR
+        self.models: Dict[str, str] = {}  # model name -> qualified class name
+        self.model_headers: List[str] = []
+        self.project_sources: List[Path] = []  # implementations the helpers need at link time
+        self.err_resp_header: Optional[str] = None
+        self.uses_drogon = False
+
+    def scan(self, cpp_files: Iterable[Path]) -> bool:
+        """Find models and project helpers; return whether there is anything to emit"""
+        cpp_files = list(cpp_files)
+        by_stem: Dict[str, List[Path]] = {}
+        for file_path in cpp_files:
+            by_stem.setdefault(file_path.stem, []).append(file_path)
+
+        def implementations(header: Path) -> List[Path]:
+            return [p for p in by_stem[header.stem] if p.suffix in SOURCE_SUFFIXES and p.parent == header.parent]
+
+        for file_path in cpp_files:
+            content = self._read(file_path)
+            self.uses_drogon = self.uses_drogon or '<drogon/' in content
+            if file_path.suffix in SOURCE_SUFFIXES:
+                continue
+            if self.err_resp_header is None and re.search(r'\bmakeErrResp\s*\(', content):
+                self.err_resp_header = self._include_path(file_path)
+                self.project_sources.extend(implementations(file_path))
+            if file_path.stem not in MODEL_DEFAULTS or file_path.stem in self.models:
+                continue
+            qualified = next((name for name, _ in iter_namespace_classes(content)
+                              if name.split("::")[-1] == file_path.stem), None)
+            if qualified:
+                # Global models are spelled ::Name so lookup from inside testsupport stays unambiguous
+                self.models[file_path.stem] = qualified if "::" in qualified else f"::{qualified}"
+                self.model_headers.append(self._include_path(file_path))
+                self.project_sources.extend(implementations(file_path))
+
+        # Model factories and response helpers are built on Drogon's ORM and HTTP types
+        return self.uses_drogon
+
+    def _read(self, file_path: Path) -> str:
+        try:
+            return file_path.read_text(encoding='utf-8', errors='replace')
+        except OSError:
+            return ""
+
+    def _include_path(self, file_path: Path) -> str:
+        try:
+            return file_path.relative_to(self.project_path).as_posix()
+        except ValueError:
+            return file_path.name
+
+    def declarations(self) -> List[str]:
+        """One-line signatures to advertise in prompts"""
+        lines = [
+            "void testsupport::checkResponse(const drogon::HttpResponsePtr &resp, drogon::HttpStatusCode expected)",
+            "Json::Value testsupport::responseJson(const drogon::HttpResponsePtr &resp)",
+            "drogon::HttpRequestPtr testsupport::makeJsonRequest(const Json::Value &body, "
+            "drogon::HttpMethod method = drogon::Post)",
+            "class testsupport::ControllerTest : public ::testing::Test  // capture() callback, response, callbackCount",
+            "Json::Value testsupport::makeErrResp(const std::string &err)",
+        ]
+        lines.extend(f"{qualified} testsupport::make{name}(const Json::Value &overrides = Json::Value())"
+                     for name, qualified in self.models.items())
+        return lines
+
+    def helper_names(self) -> List[str]:
+        """Names generated tests must not redefine"""
+        return (["checkResponse", "responseJson", "makeJsonRequest", "ControllerTest", "makeErrResp"]
+                + [f"make{name}" for name in self.models])
+
+    def render_header(self) -> str:
+        includes = ["<functional>", "<string>", "<gtest/gtest.h>", "<json/json.h>",
+                    "<drogon/HttpRequest.h>", "<drogon/HttpResponse.h>"]
+        includes += [f'"{header}"' for header in self.model_headers]
+        if self.err_resp_header:
+            includes.append(f'"{self.err_resp_header}"')
+
+        body = [DROGON_DECLARATIONS]
+        if self.err_resp_header:
+            body.append(f"// makeErrResp comes from the project ({self.err_resp_header})\nusing ::makeErrResp;\n")
+        else:
+            body.append(ERR_RESP_DECLARATION)
+        for name, qualified in self.models.items():
+            body.append(f"// {name} with schema-valid defaults; keys in overrides replace individual columns\n"
+                        f"{qualified} make{name}(const Json::Value &overrides = Json::Value());\n")
+
+        return "\n".join([
+            "// Generated by test_generator.py. Do not edit; regenerated each run.",
+            "#pragma once",
+            "",
+            *[f"#include {include}" for include in includes],
+            "",
+            "namespace testsupport {",
+            "",
+            "\n".join(body).rstrip(),
+            "",
+            "}  // namespace testsupport",
+            "",
+        ])
+
+    def render_source(self) -> str:
+        body = [DROGON_DEFINITIONS]
+        if not self.err_resp_header:
+            body.append(ERR_RESP_DEFINITION)
+        for name, qualified in self.models.items():
+            fields = "\n".join(f"    json[\"{column}\"] = {self._cpp_literal(value)};"
+                               for column, value in MODEL_DEFAULTS[name].items())
+            body.append(f"""{qualified} make{name}(const Json::Value &overrides) {{
+    Json::Value json;
+{fields}
+    for (const auto &key : overrides.getMemberNames()) {{
+        json[key] = overrides[key];
+    }}
+    return {qualified}(json);
+}}
+""")
+        return "\n".join([
+            "// Generated by test_generator.py. Do not edit; regenerated each run.",
+            f'#include "{TEST_SUPPORT_HEADER}"',
+            "",
+            "namespace testsupport {",
+            "",
+            "\n".join(body).rstrip(),
+            "",
+            "}  // namespace testsupport",
+            "",
+        ])
+
+    @staticmethod
+    def _cpp_literal(value: object) -> str:
+        if isinstance(value, str):
+            return f'"{value}"'
+        return str(value)
+
+    def render_cmake(self) -> str:
+        sources = [f"    {TEST_SUPPORT_HEADER.replace('.h', '.cpp')}"]
+        sources += [f'    "{source.resolve().as_posix()}"' for source in self.project_sources]
+        return f"""# Generated by test_generator.py: shared helpers compiled once for every test target
+add_library(test_support STATIC
+{chr(10).join(sources)}
+)
+
+target_include_directories(test_support PUBLIC
+    ${{CMAKE_CURRENT_SOURCE_DIR}}
+    "{self.project_path.resolve().as_posix()}"
+)
+
+find_package(Drogon CONFIG REQUIRED)
+target_link_libraries(test_support PUBLIC
+    Drogon::Drogon
+    ${{GTEST_LIBRARIES}}
+)
+"""
+
+    def write(self) -> Path:
+        """Write the library sources and its CMakeLists.txt"""
+        self.support_dir.mkdir(parents=True, exist_ok=True)
+        (self.support_dir / TEST_SUPPORT_HEADER).write_text(self.render_header(), encoding='utf-8')
+        (self.support_dir / TEST_SUPPORT_HEADER.replace('.h', '.cpp')).write_text(self.render_source(),
+                                                                                 encoding='utf-8')
+        (self.support_dir / "CMakeLists.txt").write_text(self.render_cmake(), encoding='utf-8')
+        logger.info(f"Generated test_support library with {len(self.models)} model factories in {self.support_dir}")
+        return self.support_dir
@@ -0,0 +1,197 @@
+"""
+Span tracing
+Hierarchical spans (pipeline, stage, file, provider call, compile, test run)
+written as JSONL or as Chrome trace events that load in Perfetto, so stage
+overlap and idle gaps under concurrency are visible
+"""
+
+import os
+import json
+import time
+import logging
+import itertools
+import functools
+import threading
+from contextlib import contextmanager
+from pathlib import Path
+from typing import Any, Callable, Dict, Iterator, List, Optional
+
+
+class Span:
+    """One timed operation; attributes may be added while it is open"""
+
+    __slots__ = ('name', 'kind', 'id', 'parent', 'start', 'end', 'thread', 'attrs', 'errors')
+
+    def __init__(self, name: str, kind: str, span_id: int, parent: Optional[int], attrs: Dict[str, Any]):
+        self.name = name
+        self.kind = kind
+        self.id = span_id
+        self.parent = parent
+        self.start = time.time()
+        self.end = self.start
+        self.thread = threading.current_thread()
+        self.attrs = attrs
+        self.errors: List[str] = []
+
+    def set(self, **attrs):
+        self.attrs.update(attrs)
+
+
+class Tracer:
+    """Records spans to `path`: Chrome trace-event JSON for a .json suffix, JSONL otherwise.
+    Without a path every call is a no-op"""
+
+    def __init__(self, path: Optional[Path] = None):
+        self.path = Path(path) if path else None
+        self.enabled = self.path is not None
+        self.chrome = self.enabled and self.path.suffix == '.json'
+        self._local = threading.local()
+        self._ids = itertools.count(1)
+        self._lock = threading.Lock()
+        self._named_threads = set()
+        self._file = None
+        self._handlers: List[tuple] = []  # (logger, handler) pairs removed again on close
+        self.spans = 0
+        if self.enabled:
+            self.path.parent.mkdir(parents=True, exist_ok=True)
+            self._file = open(self.path, 'w', encoding='utf-8')
+            if self.chrome:
+                # Array format: Perfetto and chrome://tracing accept it without the closing bracket,
+                # so a run that dies half way still leaves a loadable trace
+                self._file.write("[\n")
+
+    def _stack(self) -> List[Span]:
+        stack = getattr(self._local, 'stack', None)
+        if stack is None:
+            stack = self._local.stack = []
+        return stack
+
+    def current(self) -> Optional[Span]:
+        stack = self._stack()
+        return stack[-1] if stack else None
+
+    @contextmanager
+    def span(self, name: str, kind: str = "span", **attrs) -> Iterator[Optional[Span]]:
+        if not self.enabled:
+            yield None
+            return
+        parent = self.current()
+        span = Span(name, kind, next(self._ids), parent.id if parent else None, attrs)
+        stack = self._stack()
+        stack.append(span)
+        try:
+            yield span
+        except BaseException as e:
+            span.errors.append(f"{type(e).__name__}: {e}")
+            raise
+        finally:
+            span.end = time.time()
+            stack.pop()
+            self._write(span)
+
+    def annotate(self, **attrs):
+        """Add attributes to the innermost open span of this thread"""
+        span = self.current()
+        if span is not None:
+            span.set(**attrs)
+
+    def error(self, message: str):
+        span = self.current()
+        if span is not None:
+            span.errors.append(message)
+
+    def capture_errors(self, logger: logging.Logger):
+        """Attach logger's ERROR records to the open span until close(); a no-op without a path"""
+        if self.enabled and not any(attached is logger for attached, _ in self._handlers):
+            handler = SpanErrorHandler(self)
+            logger.addHandler(handler)
+            self._handlers.append((logger, handler))
+
+    def wrap(self, fn: Callable) -> Callable:
+        """Bind fn to the current span, so spans it opens on pool threads nest under it"""
+        if not self.enabled:
+            return fn
+        parent = self.current()
+
+        @functools.wraps(fn)
+        def run(*args, **kwargs):
+            stack = self._stack()
+            saved = list(stack)
+            stack[:] = [parent] if parent else []
+            try:
+                return fn(*args, **kwargs)
+            finally:
+                stack[:] = saved
+        return run
+
+    def _write(self, span: Span):
+        tid = span.thread.ident or 0
+        if self.chrome:
+            args = dict(span.attrs, span_id=span.id, parent_id=span.parent)
+            if span.errors:
+                args["errors"] = span.errors
+            text = json.dumps({"name": span.name, "cat": span.kind, "ph": "X", "pid": os.getpid(), "tid": tid,
+                               # Epoch microseconds, so traces of worker processes line up with the coordinator's
+                               "ts": round(span.start * 1e6),
+                               "dur": round((span.end - span.start) * 1e6), "args": args}, default=str) + ",\n"
+        else:
+            text = json.dumps({"name": span.name, "kind": span.kind, "span_id": span.id, "parent_id": span.parent,
+                               "start": round(span.start, 6), "end": round(span.end, 6),
+                               "duration_s": round(span.end - span.start, 6), "thread": span.thread.name,
+                               "attrs": span.attrs, "errors": span.errors}, default=str) + "\n"
+        with self._lock:
+            # Pool threads emit concurrently; naming each thread once happens under the same lock as the write
+            if self.chrome and tid not in self._named_threads:
+                self._named_threads.add(tid)
+                text = json.dumps({"ph": "M", "name": "thread_name", "pid": os.getpid(), "tid": tid,
+                                   "args": {"name": span.thread.name}}) + ",\n" + text
+            if self._file is not None:
+                self._file.write(text)
+                self._file.flush()
+                self.spans += 1
+
+    def close(self):
+        for logger, handler in self._handlers:
+            logger.removeHandler(handler)
+        self._handlers = []
+        with self._lock:
+            if self._file is not None:
+                if self.chrome:
+                    # A trailing metadata event keeps the array valid after the last comma
+                    self._file.write(json.dumps({"ph": "M", "name": "process_name", "pid": os.getpid(),
+                                                 "args": {"name": "test_generator"}}) + "\n]\n")
+                self._file.close()
+                self._file = None
+
+
+class SpanErrorHandler(logging.Handler):
+    """Attaches ERROR log records to the span open on the logging thread, so failures the
+    pipeline catches and logs still show up on their spans"""
+
+    def __init__(self, tracer: Tracer):
+        super().__init__(logging.ERROR)
+        self.tracer = tracer
+
+    def emit(self, record: logging.LogRecord):
+        self.tracer.error(record.getMessage())
+
+
+def traced(kind: str, name: Optional[str] = None, attrs: Optional[Callable[..., Dict[str, Any]]] = None):
+    """Run a method of an object with a `tracer` attribute inside a span; `attrs` maps the
+    call's arguments to span attributes. Boolean results (or (bool, output) pairs) are recorded as `ok`"""
+    def decorate(method):
+        @functools.wraps(method)
+        def wrapper(self, *args, **kwargs):
+            tracer: Tracer = self.tracer
+            if not tracer.enabled:
+                return method(self, *args, **kwargs)
+            span_attrs = attrs(*args, **kwargs) if attrs else {}
+            with tracer.span(name or method.__name__, kind, **span_attrs) as span:
+                result = method(self, *args, **kwargs)
+                if isinstance(result, tuple) and result and isinstance(result[0], bool):
+                    span.set(ok=result[0])  # (success, output) from builds and test runs
+                elif isinstance(result, bool):
+                    span.set(ok=result)
+                return result
+        return wrapper
+    return decorate